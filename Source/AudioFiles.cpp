@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    AudioFiles.cpp
+
+  ==============================================================================
+*/
+
+#include "AudioFiles.h"
+#include "OpenFileLimit.h"
+
+//==============================================================================
+namespace
+{
+    /** Passes reads through to another reader, while counting as an open file. */
+    class LimitedReader  : public juce::AudioFormatReader
+    {
+    public:
+        LimitedReader (std::unique_ptr<OpenFileLimit::ScopedFile> f, std::unique_ptr<juce::AudioFormatReader> r)
+            : AudioFormatReader (nullptr, r->getFormatName()),
+              openFile (std::move (f)), source (std::move (r))
+        {
+            sampleRate = source->sampleRate;
+            bitsPerSample = source->bitsPerSample;
+            lengthInSamples = source->lengthInSamples;
+            numChannels = source->numChannels;
+            usesFloatingPointData = source->usesFloatingPointData;
+            metadataValues = source->metadataValues;
+        }
+
+        bool readSamples (int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                          juce::int64 startSampleInFile, int numSamples) override
+        {
+            return source->readSamples (destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+        }
+
+    private:
+        // Declared first, so that it's released after the file is closed.
+        std::unique_ptr<OpenFileLimit::ScopedFile> openFile;
+        std::unique_ptr<juce::AudioFormatReader> source;
+    };
+
+    /** Passes writes through to another writer, while counting as an open file. */
+    class LimitedWriter  : public juce::AudioFormatWriter
+    {
+    public:
+        LimitedWriter (std::unique_ptr<OpenFileLimit::ScopedFile> f, std::unique_ptr<juce::AudioFormatWriter> w)
+            : AudioFormatWriter (nullptr, w->getFormatName(), w->getSampleRate(),
+                                 (unsigned int) w->getNumChannels(), (unsigned int) w->getBitsPerSample()),
+              openFile (std::move (f)), destination (std::move (w))
+        {
+            usesFloatingPointData = destination->isFloatingPoint();
+        }
+
+        bool write (const int** samplesToWrite, int numSamples) override
+        {
+            return destination->write (samplesToWrite, numSamples);
+        }
+
+        bool flush() override
+        {
+            return destination->flush();
+        }
+
+    private:
+        std::unique_ptr<OpenFileLimit::ScopedFile> openFile;
+        std::unique_ptr<juce::AudioFormatWriter> destination;
+    };
+}
+
+//==============================================================================
+juce::AudioFormatManager& getAudioFormats()
+{
+    struct BasicFormats  : public juce::AudioFormatManager
+    {
+        BasicFormats()      { registerBasicFormats(); }
+    };
+
+    static BasicFormats formats;
+    return formats;
+}
+
+std::unique_ptr<juce::AudioFormatReader> createSampleReader (const juce::File& file)
+{
+    if(OpenFileLimit::getMaximum() == 0)
+        return std::unique_ptr<juce::AudioFormatReader> (getAudioFormats().createReaderFor (file));
+
+    // The slot is taken before the file is opened, and handed to the wrapper.
+    auto openFile = std::make_unique<OpenFileLimit::ScopedFile>();
+    std::unique_ptr<juce::AudioFormatReader> reader (getAudioFormats().createReaderFor (file));
+
+    if(reader == nullptr)
+        return nullptr;
+
+    return std::make_unique<LimitedReader> (std::move (openFile), std::move (reader));
+}
+
+std::unique_ptr<juce::AudioFormatWriter> createSampleWriter (const juce::File& file, juce::AudioFormat& format,
+                                                             double sampleRate, int numChannels,
+                                                             int bitsPerSample, bool isFloatingPoint,
+                                                             const juce::StringPairArray& metadataValues)
+{
+    auto openFile = OpenFileLimit::getMaximum() > 0 ? std::make_unique<OpenFileLimit::ScopedFile>() : nullptr;
+
+    auto fileStream = std::make_unique<juce::FileOutputStream> (file);
+    if(fileStream->failedToOpen() || ! fileStream->setPosition (0) || fileStream->truncate().failed())
+        return nullptr;
+
+    auto options = juce::AudioFormatWriterOptions{}.withSampleRate (sampleRate)
+                                                   .withNumChannels (numChannels)
+                                                   .withBitsPerSample (bitsPerSample)
+                                                   .withMetadataValues (metadataValues)
+                                                   .withSampleFormat (isFloatingPoint ? juce::AudioFormatWriterOptions::SampleFormat::floatingPoint
+                                                                                      : juce::AudioFormatWriterOptions::SampleFormat::integral);
+
+    std::unique_ptr<juce::OutputStream> stream (std::move (fileStream));
+    auto writer = format.createWriterFor (stream, options);
+
+    if(writer == nullptr || openFile == nullptr)
+        return writer;
+
+    return std::make_unique<LimitedWriter> (std::move (openFile), std::move (writer));
+}
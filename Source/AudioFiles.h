@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    AudioFiles.h
+
+    Opening sample files for reading and writing through JUCE's audio formats.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** The formats used by every stage that decodes or writes audio. Readers and
+    writers can be created from any thread.
+*/
+juce::AudioFormatManager& getAudioFormats();
+
+/** Opens a sample file with whichever format can read it, or returns nullptr. */
+std::unique_ptr<juce::AudioFormatReader> createSampleReader (const juce::File& file);
+
+/** Creates a writer that replaces the contents of a file, or returns nullptr
+    if the file can't be opened or the format doesn't support these settings.
+*/
+std::unique_ptr<juce::AudioFormatWriter> createSampleWriter (const juce::File& file, juce::AudioFormat& format,
+                                                             double sampleRate, int numChannels,
+                                                             int bitsPerSample, bool isFloatingPoint,
+                                                             const juce::StringPairArray& metadataValues = {});
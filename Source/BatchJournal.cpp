@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    BatchJournal.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchJournal.h"
+#include "FastHash.h"
+#include "PresetDocument.h"
+
+//==============================================================================
+namespace
+{
+    const char* const journalIdentifier = "EXS2DS batch journal 3";
+    constexpr int numFieldsPerLine = 7;
+
+    constexpr int maxUnflushedEntries = 100;
+    constexpr juce::uint32 maxFlushIntervalMilliseconds = 5000;
+}
+
+//==============================================================================
+BatchJournal::~BatchJournal()
+{
+    flush();
+}
+
+juce::uint64 BatchJournal::getJobKey (const juce::File& inputFile, const juce::File& outputFile)
+{
+    auto paths = inputFile.getFullPathName() + "\t" + outputFile.getFullPathName();
+
+    FastHash hash;
+    hash.update (paths.toRawUTF8(), paths.getNumBytesAsUTF8());
+    return hash.getHash();
+}
+
+juce::uint64 BatchJournal::hashOptions (const ConversionOptions& job)
+{
+    // Every option but the input and output, which are the journal's key.
+    juce::StringArray fields;
+    fields.add (job.sampleDirectory);
+
+    for(bool flag : { job.fixLoops, job.deduplicateSamples, job.collectSamples, job.physicalOrder, job.writePreloadManifest,
+                      job.bakeCrossfades, job.trimSilence, job.writeTrimmedFiles, job.analyseLevels, job.applyVolumeTrims })
+        fields.add (flag ? "1" : "0");
+
+    fields.add (juce::String ((int) job.consolidation));
+    fields.add (juce::String ((int) job.loopRefinement));
+    fields.add (juce::String (job.loopSearchRadius));
+    fields.add (job.transcodeTarget.formatName);
+    fields.add (juce::String (job.transcodeTarget.bitsPerSample));
+    fields.add (job.transcodeTarget.isFloatingPoint ? "1" : "0");
+
+    auto text = fields.joinIntoString ("\t");
+
+    FastHash hash;
+    hash.update (text.toRawUTF8(), text.getNumBytesAsUTF8());
+    return hash.getHash();
+}
+
+juce::uint64 BatchJournal::hashWrittenSamples (const ConversionOptions& job)
+{
+    if(! job.writesSamples())
+        return 0;
+
+    auto preset = PresetDocument::parse (job.outputFile.loadFileAsString(), job.outputFile.getParentDirectory());
+    if(preset == nullptr)
+        return 0;
+
+    // Only the files the conversion wrote. The original samples are the
+    // user's, and belong to the EXS file rather than the job.
+    auto sampleDirectory = job.getSampleTargetDirectory();
+
+    FastHash hash;
+    for(auto& file : preset->getUniqueSampleFiles()) {
+        if(! file.isAChildOf (sampleDirectory))
+            continue;
+
+        auto path = file.getFullPathName();
+        juce::int64 fields[] = { file.existsAsFile() ? file.getSize() : -1, file.getLastModificationTime().toMilliseconds() };
+        hash.update (path.toRawUTF8(), path.getNumBytesAsUTF8());
+        hash.update (fields, sizeof (fields));
+    }
+
+    return hash.getHash();
+}
+
+juce::Result BatchJournal::load (const juce::File& journalFile)
+{
+    if(! journalFile.existsAsFile())
+        return juce::Result::ok();
+
+    juce::FileInputStream in (journalFile);
+    if(in.failedToOpen())
+        return juce::Result::fail ("Couldn't read \"" + journalFile.getFullPathName() + "\".");
+
+    if(in.readNextLine() != journalIdentifier)
+        return juce::Result::fail ("\"" + journalFile.getFullPathName() + "\" isn't a batch journal.");
+
+    // Read a line at a time, as a long run's journal can be large.
+    while(! in.isExhausted()) {
+        auto fields = juce::StringArray::fromTokens (in.readNextLine(), "\t", "");
+        if(fields.size() != numFieldsPerLine)
+            continue;
+
+        auto key = getJobKey (juce::File (fields[5]), juce::File (fields[6]));
+
+        // A later line for the same job replaces an earlier one.
+        if(fields[0] != "ok") {
+            completedJobs.erase (key);
+            continue;
+        }
+
+        completedJobs[key] = { (juce::uint64) fields[1].getHexValue64(), (juce::uint64) fields[2].getHexValue64(),
+                               (juce::uint64) fields[3].getHexValue64(), (juce::uint64) fields[4].getHexValue64() };
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result BatchJournal::open (const juce::File& journalFile, bool appendToExisting)
+{
+    const bool isNew = ! appendToExisting || journalFile.getSize() == 0;
+
+    if(isNew && ! journalFile.deleteFile())
+        return juce::Result::fail ("Couldn't replace \"" + journalFile.getFullPathName() + "\".");
+
+    // A crash can leave the last line cut short. New entries mustn't be
+    // appended onto it, or the first of them would be lost with it.
+    bool endsMidLine = false;
+    if(! isNew) {
+        juce::FileInputStream in (journalFile);
+        endsMidLine = in.openedOk() && in.setPosition (in.getTotalLength() - 1) && in.readByte() != '\n';
+    }
+
+    stream = std::make_unique<juce::FileOutputStream> (journalFile);
+    if(stream->failedToOpen()) {
+        stream.reset();
+        return juce::Result::fail ("Couldn't write \"" + journalFile.getFullPathName() + "\".");
+    }
+
+    if(isNew)
+        *stream << journalIdentifier << "\n";
+    else if(endsMidLine)
+        *stream << "\n";
+
+    lastFlushTime = juce::Time::getMillisecondCounter();
+    return juce::Result::ok();
+}
+
+//==============================================================================
+bool BatchJournal::isComplete (const ConversionOptions& job) const
+{
+    auto& inputFile = job.inputFile;
+    auto& outputFile = job.outputFile;
+
+    auto entry = completedJobs.find (getJobKey (inputFile, outputFile));
+    if(entry == completedJobs.end() || entry->second.optionsHash != hashOptions (job) || ! outputFile.existsAsFile())
+        return false;
+
+    juce::uint64 inputHash, outputHash;
+    return FastHash::hashFile (inputFile, inputHash) && inputHash == entry->second.inputHash
+        && FastHash::hashFile (outputFile, outputHash) && outputHash == entry->second.outputHash
+        && hashWrittenSamples (job) == entry->second.samplesHash;
+}
+
+void BatchJournal::record (const ConversionOptions& job, bool succeeded)
+{
+    auto& inputFile = job.inputFile;
+    auto& outputFile = job.outputFile;
+    auto inputPath = inputFile.getFullPathName();
+    auto outputPath = outputFile.getFullPathName();
+
+    // Such jobs just aren't journalled, so a resumed run converts them again.
+    if(inputPath.containsAnyOf ("\t\r\n") || outputPath.containsAnyOf ("\t\r\n"))
+        return;
+
+    juce::uint64 inputHash = 0, outputHash = 0, samplesHash = 0;
+    if(succeeded) {
+        succeeded = FastHash::hashFile (inputFile, inputHash) && FastHash::hashFile (outputFile, outputHash);
+        samplesHash = hashWrittenSamples (job);
+    }
+
+    const juce::ScopedLock sl (writeLock);
+    if(stream == nullptr)
+        return;
+
+    *stream << (succeeded ? "ok" : "failed") << "\t" << juce::String::toHexString ((juce::int64) inputHash) << "\t"
+            << juce::String::toHexString ((juce::int64) outputHash) << "\t"
+            << juce::String::toHexString ((juce::int64) hashOptions (job)) << "\t"
+            << juce::String::toHexString ((juce::int64) samplesHash) << "\t" << inputPath << "\t" << outputPath << "\n";
+
+    auto now = juce::Time::getMillisecondCounter();
+    if(++numUnflushed >= maxUnflushedEntries || now - lastFlushTime >= maxFlushIntervalMilliseconds) {
+        // FileOutputStream::flush() also syncs the file to disk.
+        stream->flush();
+        numUnflushed = 0;
+        lastFlushTime = now;
+    }
+}
+
+void BatchJournal::flush()
+{
+    const juce::ScopedLock sl (writeLock);
+
+    if(stream != nullptr && numUnflushed > 0) {
+        stream->flush();
+        numUnflushed = 0;
+        lastFlushTime = juce::Time::getMillisecondCounter();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    BatchJournal.h
+
+    Records which batch jobs have finished, so an interrupted run can resume.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConversionJob.h"
+#include <unordered_map>
+
+//==============================================================================
+/**
+    An append-only log of finished batch jobs. Each line gives a job's status,
+    the XXH64 hashes of its EXS file, of the preset it wrote, of the options it
+    was converted with and of the samples it wrote, and both paths.
+
+    Lines are buffered and written out, with an fsync, every 100 jobs or 5
+    seconds, whichever comes first, and when the journal is closed. A crash
+    therefore loses at most the last few entries, and those jobs are simply
+    converted again. A line cut short by a crash is ignored when the journal
+    is loaded.
+
+    A job counts as complete when the journal says it succeeded with the same
+    options, its EXS file still has the hash it had then, and its preset still
+    exists with the hash it was written with. The samples the job wrote, e.g.
+    with --collect-samples or --transcode, must also still be there with the
+    size and modification time they had. Anything else, including a preset
+    that has since been edited, a written sample that has been deleted or a
+    job whose options have changed, is converted again.
+*/
+class BatchJournal
+{
+public:
+    BatchJournal() = default;
+
+    /** Flushes anything still buffered. */
+    ~BatchJournal();
+
+    /** Loads the jobs an earlier run finished. A missing file isn't an error. */
+    juce::Result load (const juce::File& journalFile);
+
+    /** Starts recording jobs, either after what the file already holds or
+        replacing it.
+    */
+    juce::Result open (const juce::File& journalFile, bool appendToExisting);
+
+    /** Returns true if a loaded entry shows this job finished with the same
+        options, and neither its input nor anything it wrote has changed since.
+        Thread-safe.
+    */
+    bool isComplete (const ConversionOptions& job) const;
+
+    /** Records a finished job. Thread-safe. */
+    void record (const ConversionOptions& job, bool succeeded);
+
+    /** Returns a hash of everything in a job's options that affects the preset
+        or samples it writes.
+    */
+    static juce::uint64 hashOptions (const ConversionOptions& job);
+
+    /** Returns a hash of the paths, sizes and modification times of the
+        sample files that a finished job's preset points at and the job wrote,
+        or 0 if it wrote none.
+    */
+    static juce::uint64 hashWrittenSamples (const ConversionOptions& job);
+
+    /** Writes out and syncs anything buffered. Thread-safe. */
+    void flush();
+
+    /** Returns the number of completed jobs that were loaded. */
+    int getNumLoaded() const    { return (int) completedJobs.size(); }
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        juce::uint64 inputHash = 0, outputHash = 0, optionsHash = 0, samplesHash = 0;
+    };
+
+    static juce::uint64 getJobKey (const juce::File& inputFile, const juce::File& outputFile);
+
+    // Keyed by a hash of the two paths, which keeps a million-job journal small.
+    std::unordered_map<juce::uint64, Entry> completedJobs;
+
+    juce::CriticalSection writeLock;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    int numUnflushed = 0;
+    juce::uint32 lastFlushTime = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (BatchJournal)
+};
@@ -0,0 +1,329 @@
+/*
+  ==============================================================================
+
+    BatchRunner.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchRunner.h"
+#include "FastHash.h"
+#include "InterruptHandler.h"
+#include "JobDescription.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+//==============================================================================
+namespace
+{
+    // Every EXS chunk starts with an 84-byte header: a signature, the size of
+    // the data after the header, and then the chunk's name.
+    constexpr juce::int64 exsChunkHeaderSize = 84;
+    constexpr juce::uint32 exsZoneChunkType = 1;
+
+    /** Counts the zone chunks in an EXS file, or returns -1 if it doesn't look
+        like one. Files from PowerPC Macs are big-endian.
+
+        Only each chunk's signature and size are read, skipping from one chunk
+        to the next, so the file is never held in memory.
+    */
+    int countExsZones (juce::InputStream& exs)
+    {
+        const auto size = exs.getTotalLength();
+        if(size < exsChunkHeaderSize)
+            return -1;
+
+        juce::uint8 header[8];
+
+        auto readChunkHeader = [&] (juce::int64 position) {
+            return exs.setPosition (position) && exs.read (header, sizeof (header)) == (int) sizeof (header);
+        };
+
+        if(! readChunkHeader (0))
+            return -1;
+
+        // The first chunk is always the instrument's, with a signature of 0x100 or 0x101.
+        const bool isBigEndian = (juce::ByteOrder::littleEndianInt (header) & ~1u) != 0x100;
+        if(isBigEndian && (juce::ByteOrder::bigEndianInt (header) & ~1u) != 0x100)
+            return -1;
+
+        auto readInt = [&] (int offset) {
+            return isBigEndian ? juce::ByteOrder::bigEndianInt (header + offset)
+                               : juce::ByteOrder::littleEndianInt (header + offset);
+        };
+
+        int numZones = 0;
+
+        for(juce::int64 position = 0; position + 8 <= size && readChunkHeader (position); position += exsChunkHeaderSize + readInt (4)) {
+            if(((readInt (0) >> 24) & 0x0f) == exsZoneChunkType)
+                ++numZones;
+        }
+
+        return numZones;
+    }
+}
+
+//==============================================================================
+BatchRunner::BatchRunner (const ConversionOptions& o, ConversionContext& c, int n)
+    : defaultOptions (o), context (c),
+      numWorkers (n > 0 ? n : juce::SystemStats::getNumCpus())
+{
+    pipelineOptions.numFixupWorkers = numWorkers;
+}
+
+void BatchRunner::setPipelineOptions (const ConversionPipeline::Options& options)
+{
+    pipelineOptions = options;
+    pipelineOptions.numFixupWorkers = numWorkers;
+}
+
+void BatchRunner::setLookahead (int numJobs)
+{
+    jassert (numJobs > 0);
+    lookahead = juce::jmax (numJobs, 1);
+}
+
+void BatchRunner::setMemoryBudget (juce::int64 maxBytes)
+{
+    memory = std::make_unique<MemoryBudget> (maxBytes);
+}
+
+BatchRunner::JobEstimate BatchRunner::estimateJob (const juce::File& exsFile)
+{
+    // Each zone means finding, probing and often rewriting a sample, which
+    // outweighs the zone's few hundred bytes in the EXS file itself.
+    constexpr juce::int64 costPerZone = 65536;
+
+    // The EXS file and the preset XML made from it, plus each zone's element,
+    // sample header and share of the per-sample buffers.
+    constexpr juce::int64 memoryPerExsByte = 8;
+    constexpr juce::int64 memoryPerZone = 16384;
+
+    JobEstimate estimate;
+
+    juce::FileInputStream file (exsFile);
+    if(file.failedToOpen())
+        return estimate;
+
+    // Zone chunks are a few hundred bytes apart, so a small buffer turns the
+    // seeks between them into a handful of reads.
+    const auto exsSize = file.getTotalLength();
+    juce::BufferedInputStream exs (file, 4096);
+
+    const auto numZones = (juce::int64) juce::jmax (countExsZones (exs), 0);
+    estimate.cost = exsSize + numZones * costPerZone;
+    estimate.memoryBytes = exsSize * memoryPerExsByte + numZones * memoryPerZone;
+    return estimate;
+}
+
+void BatchRunner::setShard (int number, int count)
+{
+    jassert (count > 0 && number >= 1 && number <= count);
+    shardNumber = number;
+    numShards = count;
+}
+
+int BatchRunner::getShardFor (const juce::String& relativeInputPath, int count)
+{
+    // Separators are normalised so that Windows and Unix machines agree.
+    auto path = relativeInputPath.replaceCharacter ('\\', '/');
+
+    FastHash hash;
+    hash.update (path.toRawUTF8(), path.getNumBytesAsUTF8());
+    return (int) (hash.getHash() % (juce::uint64) count) + 1;
+}
+
+void BatchRunner::setJournal (BatchJournal* j, bool skipCompleted)
+{
+    journal = j;
+    skipCompletedJobs = skipCompleted && j != nullptr;
+}
+
+juce::Result BatchRunner::run (const juce::File& manifestFile)
+{
+    juce::FileInputStream manifest (manifestFile);
+    if(manifest.failedToOpen())
+        return juce::Result::fail ("Couldn't open \"" + manifestFile.getFullPathName() + "\".");
+
+    manifestName = manifestFile.getFileName();
+    const auto baseDirectory = manifestFile.getParentDirectory();
+
+    ConversionPipeline pipeline (context, pipelineOptions);
+    activePipeline = &pipeline;
+
+    juce::WaitableEvent pipelineFinished;
+    std::thread pipelineThread ([this, &pipeline, &pipelineFinished]
+    {
+        pipeline.run ([this] { return startNextJob(); },
+                      [this] (std::unique_ptr<PresetConversion> finished) { finishJob (std::move (finished)); });
+        pipelineFinished.signal();
+    });
+
+    for(int lineNumber = 1; ! manifest.isExhausted() && ! checkForInterruption(); ++lineNumber) {
+        auto line = manifest.readNextLine().trim();
+        if(line.isEmpty() || line.startsWithChar ('#'))
+            continue;
+
+        Job job;
+        job.lineNumber = lineNumber;
+        job.options = defaultOptions;
+
+        auto result = readJobDescription (juce::JSON::parse (line), baseDirectory, job.options);
+        if(result.failed()) {
+            reportFailure (lineNumber, result.getErrorMessage());
+            continue;
+        }
+
+        if(numShards > 1 && getShardFor (job.options.inputFile.getRelativePathFrom (baseDirectory), numShards) != shardNumber) {
+            ++numInOtherShards;
+            continue;
+        }
+
+        if(job.options.outputFile == juce::File())
+            job.options.outputFile = job.options.inputFile.withFileExtension (".dspreset");
+
+        job.estimate = estimateJob (job.options.inputFile);
+        addJob (std::move (job));
+    }
+
+    {
+        std::lock_guard<std::mutex> sl (queueLock);
+        isFinishedReading = true;
+    }
+
+    jobAdded.notify_all();
+
+    while(! pipelineFinished.wait (interruptPollMilliseconds))
+        checkForInterruption();
+
+    pipelineThread.join();
+    activePipeline = nullptr;
+    numNotStarted += pipeline.getNumDropped();
+
+    if(journal != nullptr)
+        journal->flush();
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+void BatchRunner::addJob (Job&& job)
+{
+    std::unique_lock<std::mutex> sl (queueLock);
+    auto hasRoom = [this] { return isCancelled || queue.size() < (size_t) juce::jmax (lookahead, numWorkers); };
+
+    while(! jobTaken.wait_for (sl, std::chrono::milliseconds (interruptPollMilliseconds), hasRoom)) {
+        sl.unlock();
+        checkForInterruption();
+        sl.lock();
+    }
+
+    if(isCancelled)
+        return;
+
+    queue.push_back (std::move (job));
+    std::push_heap (queue.begin(), queue.end());
+    sl.unlock();
+
+    jobAdded.notify_one();
+}
+
+bool BatchRunner::getNextJob (Job& job)
+{
+    std::unique_lock<std::mutex> sl (queueLock);
+    jobAdded.wait (sl, [this] { return ! queue.empty() || isFinishedReading; });
+
+    if(queue.empty())
+        return false;
+
+    // Idle parse workers all take from the one heap, so whichever frees up
+    // first gets the biggest job left.
+    std::pop_heap (queue.begin(), queue.end());
+    job = std::move (queue.back());
+    queue.pop_back();
+    sl.unlock();
+
+    jobTaken.notify_one();
+    return true;
+}
+
+std::unique_ptr<PresetConversion> BatchRunner::startNextJob()
+{
+    Job job;
+
+    while(getNextJob (job)) {
+        // Checked here rather than while reading the manifest, so that the
+        // hashing is spread across the parse workers.
+        if(skipCompletedJobs && journal->isComplete (job.options)) {
+            ++numAlreadyComplete;
+            continue;
+        }
+
+        auto conversion = std::make_unique<BatchConversion> (job);
+
+        // The reservation waits until enough of the budget is free, which holds
+        // back the parse workers, and once the queue fills, the manifest reader
+        // too. It's given back when the job leaves the pipeline.
+        if(memory != nullptr)
+            conversion->reservation = std::make_unique<MemoryBudget::ScopedReservation> (*memory, job.estimate.memoryBytes);
+
+        if(isCancelled) {
+            ++numNotStarted;
+            return nullptr;
+        }
+
+        return conversion;
+    }
+
+    return nullptr;
+}
+
+void BatchRunner::finishJob (std::unique_ptr<PresetConversion> finished)
+{
+    auto& conversion = static_cast<BatchConversion&> (*finished);
+    auto& result = conversion.getResult();
+
+    if(journal != nullptr)
+        journal->record (conversion.options, result.wasOk());
+
+    if(result.failed())
+        reportFailure (conversion.lineNumber, result.getErrorMessage());
+    else
+        ++numSucceeded;
+}
+
+bool BatchRunner::checkForInterruption()
+{
+    if(! InterruptHandler::wasInterrupted())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> sl (queueLock);
+        if(isCancelled)
+            return true;
+
+        // Nothing else is started: the waiting jobs are forgotten, and the
+        // pipeline drops any that haven't reached the write stage yet.
+        isCancelled = true;
+        isFinishedReading = true;
+        numNotStarted += (int) queue.size();
+        queue.clear();
+    }
+
+    jobAdded.notify_all();
+    jobTaken.notify_all();
+
+    if(activePipeline != nullptr)
+        activePipeline->cancel();
+
+    return true;
+}
+
+void BatchRunner::reportFailure (int lineNumber, const juce::String& message)
+{
+    ++numFailed;
+
+    const juce::ScopedLock sl (reportLock);
+    std::cerr << manifestName << ":" << lineNumber << ": " << message << std::endl;
+}
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    BatchRunner.h
+
+    Converts the jobs listed in a manifest file in parallel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BatchJournal.h"
+#include "ConversionJob.h"
+#include "ConversionPipeline.h"
+#include "MemoryBudget.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+/**
+    The batch command: converts every job in a JSON Lines manifest, one job
+    per line in the form read by readJobDescription(), e.g.
+
+        {"input": "Keys/Piano.exs", "output": "out/Piano.dspreset", "sampleDirectory": "Samples"}
+
+    Relative paths are taken from the manifest's folder, and a job without an
+    output writes its preset next to its EXS file. Blank lines and lines
+    starting with # are skipped.
+
+    The manifest is read a line at a time into a window of waiting jobs that
+    a ConversionPipeline takes jobs from, so its size doesn't matter: reading
+    stops whenever the window is full and starts again as the pipeline frees
+    up. The pipeline's fixup stage, where most of the work is, gets numWorkers
+    threads. Every job shares the ConversionContext, so samples used by more
+    than one preset are indexed and probed once.
+
+    Within the window, the biggest job is always taken first, judged from the
+    size of its EXS file and the number of zones in it. A huge preset found
+    early then runs alongside the small ones rather than being left until
+    last with every other worker idle. The bigger the window, the closer this
+    gets to sorting the whole manifest.
+
+    Each job also reserves an estimate of the memory it needs from an optional
+    budget before it starts, so workers wait rather than start a job that
+    would go over. Limits on open files and metadata operations come from the
+    ConversionContext and slow every job down in the same way.
+
+    A run can be split across machines by giving each one a shard. Jobs are
+    assigned to shards by the XXH64 hash of their input's path relative to the
+    manifest, so every machine agrees on the split without talking to the
+    others, whatever order the manifest lists the jobs in.
+
+    With a BatchJournal, every finished job is recorded, and a resumed run
+    skips the jobs the journal shows are still complete.
+
+    Once InterruptHandler reports a signal, no more jobs are started and the
+    manifest isn't read any further. Jobs already being written are finished,
+    and the rest are dropped without touching their presets, so that the run
+    can be resumed from the journal.
+*/
+class BatchRunner
+{
+public:
+    /** Jobs start from these options before their JSON is applied. */
+    BatchRunner (const ConversionOptions& defaultOptions, ConversionContext& context, int numWorkers);
+
+    /** Sets how many threads each stage of the pipeline gets, apart from the
+        fixup stage, which always gets the numWorkers given to the constructor.
+    */
+    void setPipelineOptions (const ConversionPipeline::Options& options);
+
+    /** Sets how many jobs can be waiting at once for a worker. The default is
+        defaultLookahead.
+    */
+    void setLookahead (int numJobs);
+
+    /** Converts every job in the manifest and returns once they've all
+        finished, or once an interrupted run has wound down. Jobs that fail are
+        reported on stderr and counted; this only fails if the manifest
+        couldn't be read.
+    */
+    juce::Result run (const juce::File& manifestFile);
+
+    /** Only converts the jobs in one of numShards shards, numbered from 1. */
+    void setShard (int shardNumber, int numShards);
+
+    /** Returns the shard, numbered from 1, that a job belongs to, given its
+        input's path relative to the manifest.
+    */
+    static int getShardFor (const juce::String& relativeInputPath, int numShards);
+
+    /** Limits the memory that running jobs are estimated to need, in total. */
+    void setMemoryBudget (juce::int64 maxBytes);
+
+    struct JobEstimate
+    {
+        /** A rough measure of how long the job will take, only useful for
+            comparing one job with another.
+        */
+        juce::int64 cost = 0;
+
+        /** Roughly how much memory the job will hold while it runs. */
+        juce::int64 memoryBytes = 0;
+    };
+
+    /** Estimates the cost of converting an EXS file, from its size and the
+        zones counted in a quick scan of its chunks.
+    */
+    static JobEstimate estimateJob (const juce::File& exsFile);
+
+    static constexpr int defaultLookahead = 1000;
+
+    /** Records every finished job in the journal. If skipCompletedJobs is
+        true, jobs the journal already shows as complete aren't converted.
+    */
+    void setJournal (BatchJournal* journal, bool skipCompletedJobs);
+
+    int getNumSucceeded() const         { return numSucceeded; }
+    int getNumFailed() const            { return numFailed; }
+    int getNumInOtherShards() const     { return numInOtherShards; }
+    int getNumAlreadyComplete() const   { return numAlreadyComplete; }
+
+    /** Returns true if the run was interrupted before every job was converted. */
+    bool wasCancelled() const           { return isCancelled; }
+
+    /** Returns the number of jobs that were read but dropped when the run was
+        interrupted. Jobs further down the manifest aren't counted.
+    */
+    int getNumNotStarted() const        { return numNotStarted; }
+
+private:
+    //==============================================================================
+    struct Job
+    {
+        int lineNumber = 0;
+        JobEstimate estimate;
+        ConversionOptions options;
+
+        // Orders the queue's heap so that the costliest job is at the front.
+        bool operator< (const Job& other) const     { return estimate.cost < other.estimate.cost; }
+    };
+
+    /** A job on its way through the pipeline. */
+    struct BatchConversion  : public PresetConversion
+    {
+        explicit BatchConversion (const Job& job)
+            : PresetConversion (job.options), lineNumber (job.lineNumber) {}
+
+        const int lineNumber;
+        std::unique_ptr<MemoryBudget::ScopedReservation> reservation;
+    };
+
+    void addJob (Job&& job);
+    bool getNextJob (Job& job);
+    std::unique_ptr<PresetConversion> startNextJob();
+    void finishJob (std::unique_ptr<PresetConversion> finished);
+    bool checkForInterruption();
+    void reportFailure (int lineNumber, const juce::String& message);
+
+    const ConversionOptions defaultOptions;
+    ConversionContext& context;
+    const int numWorkers;
+    int lookahead = defaultLookahead;
+    ConversionPipeline::Options pipelineOptions;
+    juce::String manifestName;
+    int shardNumber = 1, numShards = 1;
+    BatchJournal* journal = nullptr;
+    bool skipCompletedJobs = false;
+    std::unique_ptr<MemoryBudget> memory;
+
+    std::mutex queueLock;
+    std::condition_variable jobAdded, jobTaken;
+    std::vector<Job> queue;
+    bool isFinishedReading = false;
+    std::atomic<bool> isCancelled { false };
+    ConversionPipeline* activePipeline = nullptr;
+
+    // How often waits are broken off to check for a signal.
+    static constexpr int interruptPollMilliseconds = 100;
+
+    juce::CriticalSection reportLock;
+    std::atomic<int> numSucceeded { 0 }, numFailed { 0 }, numAlreadyComplete { 0 }, numNotStarted { 0 };
+    int numInOtherShards = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (BatchRunner)
+};
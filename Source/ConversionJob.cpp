@@ -0,0 +1,381 @@
+/*
+  ==============================================================================
+
+    ConversionJob.cpp
+
+  ==============================================================================
+*/
+
+#include "ConversionJob.h"
+#include "LoopPoints.h"
+#include "OpenFileLimit.h"
+#include "PresetDocument.h"
+#include "DSPresetConverter/Source/DSEXS24.h"
+#include "DSPresetConverter/Source/DSPresetConverter.h"
+
+//==============================================================================
+/** Our equivalent of DSPresetConverter::huntForSamples(): any sample that isn't
+    where the EXS says it is gets looked up by name, first in the sample
+    directory and then anywhere below the EXS file. Unlike the converter's
+    version, this is safe on trees containing symlink loops.
+*/
+static void huntForSamples (PresetDocument& preset, SampleIndex& index,
+                                   const juce::File& searchDirectory, const juce::String& possibleSampleDirectory)
+{
+    auto sampleDirectory = searchDirectory.getChildFile (possibleSampleDirectory);
+
+    for(auto* sample : preset.getSamples()) {
+        auto file = preset.getSampleFile (*sample);
+        if(index.fileExists (file))
+            continue;
+
+        for(auto& root : juce::Array<juce::File> { sampleDirectory, searchDirectory }) {
+            auto found = index.findFileNamed (root, file.getFileName());
+            if(found != juce::File()) {
+                preset.setSampleFile (*sample, found);
+                break;
+            }
+        }
+    }
+}
+
+//==============================================================================
+ConversionContext::ConversionContext (const Options& options)
+    : metadataThrottle (options.maxMetadataOperationsPerDevice),
+      sampleIndex (stats, metadataThrottle, options.index),
+      headerCache (stats, metadataThrottle, options.headerCacheFile),
+      collector (stats, options.maxOperationsPerDevice),
+      transcoder (stats, options.transcodeMemoryBudget),
+      silenceTrimmer (stats, options.silenceThresholdDecibels),
+      threadPool (options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus()),
+      keepParsedPresets (options.keepParsedPresets)
+{
+    OpenFileLimit::setMaximum (options.maxOpenFiles);
+}
+
+juce::int64 ConversionContext::getMetadataOperationCount() const
+{
+    return stats.get ("metadata.directoryListings") + stats.get ("metadata.stats");
+}
+
+void ConversionContext::warn (const juce::String& message)
+{
+    const juce::ScopedLock sl (warningLock);
+    std::cerr << "Warning: " << message << std::endl;
+}
+
+juce::String ConversionContext::parseExsFile (const juce::File& exsFile)
+{
+    DSPresetConverter presetMaker;
+    {
+        ProfileStats::ScopedStage stage (stats, "parse");
+
+        DSEXS24 exs;
+        exs.loadExs(exsFile);
+        presetMaker.parseDSEXS24(exs);
+    }
+
+    return presetMaker.getXML();
+}
+
+juce::String ConversionContext::getPresetXml (const juce::File& exsFile, const juce::MemoryBlock* exsData)
+{
+    if(exsData != nullptr) {
+        // DSEXS24 only loads from files, so the data is spooled to a temporary one.
+        juce::TemporaryFile spooled (juce::String (".exs"));
+        if(! spooled.getFile().replaceWithData (exsData->getData(), exsData->getSize()))
+            return {};
+
+        return parseExsFile (spooled.getFile());
+    }
+
+    const auto size = exsFile.getSize();
+    const auto modificationTime = exsFile.getLastModificationTime();
+    const auto key = exsFile.getFullPathName();
+
+    if(keepParsedPresets) {
+        const juce::ScopedLock sl (parsedPresetLock);
+        auto existing = parsedPresets.find (key);
+        if(existing != parsedPresets.end() && existing->second.size == size && existing->second.modificationTime == modificationTime) {
+            stats.add ("parse.reused");
+            return existing->second.xml;
+        }
+    }
+
+    auto xml = parseExsFile (exsFile);
+
+    if(keepParsedPresets) {
+        const juce::ScopedLock sl (parsedPresetLock);
+        parsedPresets[key] = { size, modificationTime, xml };
+    }
+
+    return xml;
+}
+
+void ConversionContext::startNewRun()
+{
+    headerCache.startNewRun();
+    deduplicator.startNewRun();
+    crossfadeBaker.startNewRun();
+    levelAnalyser.startNewRun();
+    collector.startNewRun();
+    transcoder.startNewRun();
+    silenceTrimmer.startNewRun();
+}
+
+//==============================================================================
+PresetConversion::PresetConversion (const ConversionOptions& o)
+    : options (o)
+{
+}
+
+bool PresetConversion::fail (const juce::Result& failure)
+{
+    result = failure;
+    preset.reset();
+    xml = {};
+    return false;
+}
+
+juce::Array<juce::File> PresetConversion::getSampleFiles() const
+{
+    return preset != nullptr ? preset->getUniqueSampleFiles() : juce::Array<juce::File>();
+}
+
+bool PresetConversion::parse (ConversionContext& context)
+{
+    preset = PresetDocument::parse (context.getPresetXml (options.inputFile, options.inputData),
+                                    options.inputFile.getParentDirectory());
+    if(preset == nullptr)
+        return fail (juce::Result::fail ("The preset generated from \"" + options.inputFile.getFullPathName() + "\" is not valid XML."));
+
+    return true;
+}
+
+bool PresetConversion::resolveSamples (ConversionContext& context)
+{
+    jassert (preset != nullptr);
+
+    juce::String possibleSampleDirectory = options.sampleDirectory;
+    if(possibleSampleDirectory.isEmpty()) {
+        possibleSampleDirectory = options.inputFile.getFileNameWithoutExtension();
+    }
+
+    ProfileStats::ScopedStage stage (context.stats, "huntForSamples");
+    huntForSamples (*preset, context.sampleIndex, options.inputFile.getParentDirectory(), possibleSampleDirectory);
+    return true;
+}
+
+bool PresetConversion::applyFixups (ConversionContext& context)
+{
+    jassert (preset != nullptr);
+
+    auto& stats = context.stats;
+    auto searchDirectory = options.inputFile.getParentDirectory();
+
+    {
+        ProfileStats::ScopedStage stage (stats, "probeHeaders");
+        context.headerCache.probe (context.threadPool, preset->getUniqueSampleFiles());
+    }
+
+    if(options.deduplicateSamples) {
+        ProfileStats::ScopedStage stage (stats, "dedup");
+        context.deduplicator.deduplicate (*preset, context.headerCache, context.threadPool);
+    }
+
+    {
+        ProfileStats::ScopedStage stage (stats, "loopPoints");
+        juce::StringArray warnings;
+        convertLoopCrossfadePoints (*preset, context.headerCache, stats, warnings);
+        validateLoopPoints (*preset, context.headerCache, stats, options.fixLoops, warnings);
+
+        for(auto& warning : warnings)
+            context.warn (options.inputFile.getFileName() + ": " + warning);
+    }
+
+    auto sampleTargetDirectory = options.getSampleTargetDirectory();
+
+    if(options.loopRefinement != LoopRefinement::none) {
+        ProfileStats::ScopedStage stage (stats, "refineLoops");
+        refineLoopPoints (*preset, context.headerCache, stats, context.threadPool, options.loopRefinement, options.loopSearchRadius);
+    }
+
+    if(options.bakeCrossfades) {
+        ProfileStats::ScopedStage stage (stats, "bakeCrossfades");
+
+        auto baked = context.crossfadeBaker.bake (*preset, context.headerCache, sampleTargetDirectory, context.threadPool);
+        if(baked.failed())
+            return fail (baked);
+    }
+
+    if(options.trimSilence) {
+        ProfileStats::ScopedStage stage (stats, "trimSilence");
+
+        auto trimmed = context.silenceTrimmer.trim (*preset, context.headerCache, context.threadPool,
+                                                    options.writeTrimmedFiles ? sampleTargetDirectory : juce::File());
+        if(trimmed.failed())
+            return fail (trimmed);
+    }
+
+    if(options.transcodeTarget.formatName.isNotEmpty()) {
+        ProfileStats::ScopedStage stage (stats, "transcode");
+
+        auto transcoded = context.transcoder.transcode (*preset, context.headerCache, options.transcodeTarget,
+                                                        sampleTargetDirectory, context.threadPool);
+        if(transcoded.failed())
+            return fail (transcoded);
+    }
+
+    if(options.analyseLevels || options.applyVolumeTrims) {
+        ProfileStats::ScopedStage stage (stats, "analyseLevels");
+
+        juce::StringArray warnings;
+        auto analysed = context.levelAnalyser.analyse (*preset, context.threadPool, options.applyVolumeTrims,
+                                                       options.outputFile.withFileExtension (".levels.tsv"), warnings);
+        for(auto& warning : warnings)
+            context.warn (options.inputFile.getFileName() + ": " + warning);
+
+        if(analysed.failed())
+            return fail (analysed);
+    }
+
+    if(options.consolidation != ConsolidationScope::none) {
+        ProfileStats::ScopedStage stage (stats, "consolidate");
+
+        auto consolidated = consolidateSamples (*preset, context.headerCache, stats, context.threadPool, options.consolidation,
+                                                sampleTargetDirectory, options.outputFile.getFileNameWithoutExtension());
+        if(consolidated.failed())
+            return fail (consolidated);
+    }
+
+    if(options.collectSamples) {
+        ProfileStats::ScopedStage stage (stats, "collectSamples");
+
+        auto collected = context.collector.collect (*preset, sampleTargetDirectory, context.threadPool);
+        if(collected.failed())
+            return fail (collected);
+    }
+
+    if(options.physicalOrder) {
+        ProfileStats::ScopedStage stage (stats, "physicalOrder");
+        sortSamplesByPhysicalLayout (*preset, stats, context.threadPool);
+    }
+
+    if(options.writePreloadManifest) {
+        auto saved = PreloadManifest::fromPreset (*preset, context.headerCache).save (options.outputFile.withFileExtension (".preload"));
+        if(saved.failed())
+            return fail (saved);
+    }
+
+    // Sample paths stay absolute until here so that every stage above can find the files.
+    if(options.sampleDirectory.isNotEmpty())
+        preset->convertPathsToDesiredDirectory (options.sampleDirectory);
+    else
+        preset->convertPathsToRelative (searchDirectory);
+
+    return true;
+}
+
+bool PresetConversion::serialise (ConversionContext& context)
+{
+    jassert (preset != nullptr);
+
+    {
+        ProfileStats::ScopedStage stage (context.stats, "serialise");
+        xml = preset->toString();
+    }
+
+    DBG(xml);
+
+    // The document is usually far bigger than its text, and isn't needed again.
+    preset.reset();
+    return true;
+}
+
+bool PresetConversion::write (ConversionContext& context)
+{
+    auto& stats = context.stats;
+    ProfileStats::ScopedStage stage (stats, "write");
+
+    if(options.outputStream != nullptr) {
+        if(! options.outputStream->writeText (xml, false, false, nullptr))
+            return fail (juce::Result::fail ("Couldn't write the preset generated from \"" + options.inputFile.getFullPathName() + "\"."));
+
+        stats.add ("presetsConverted");
+        return true;
+    }
+
+    // Written next to the output and then renamed over it, so an interrupted
+    // write leaves either the old preset or the new one, never half of one.
+    auto cantWrite = juce::Result::fail ("Couldn't write \"" + options.outputFile.getFullPathName() + "\".");
+    if(! options.outputFile.getParentDirectory().createDirectory())
+        return fail (cantWrite);
+
+    juce::TemporaryFile temp (options.outputFile);
+    if(! temp.getFile().appendText (xml) || ! temp.overwriteTargetFileWithTemporary())
+        return fail (cantWrite);
+
+    xml = {};
+    stats.add ("presetsConverted");
+    return true;
+}
+
+//==============================================================================
+juce::Result findPresetSamples (const ConversionOptions& options, ConversionContext& context,
+                                juce::Array<juce::File>& sampleFiles)
+{
+    PresetConversion conversion (options);
+    if(conversion.parse (context) && conversion.resolveSamples (context))
+        sampleFiles = conversion.getSampleFiles();
+
+    return conversion.getResult();
+}
+
+//==============================================================================
+juce::File ConversionOptions::getSampleTargetDirectory() const
+{
+    return outputFile.getParentDirectory().getChildFile (sampleDirectory);
+}
+
+bool ConversionOptions::writesSamples() const
+{
+    // Kept in step with the stages in PresetConversion::applyFixups().
+    return bakeCrossfades || (trimSilence && writeTrimmedFiles) || transcodeTarget.formatName.isNotEmpty()
+        || consolidation != ConsolidationScope::none || collectSamples;
+}
+
+juce::Array<juce::File> ConversionOptions::getWrittenLocations() const
+{
+    // Kept in step with the stages in PresetConversion::applyFixups() and write().
+    juce::Array<juce::File> locations;
+
+    if(outputStream == nullptr)
+        locations.add (outputFile);
+
+    if(writesSamples())
+        locations.add (getSampleTargetDirectory());
+
+    if(analyseLevels || applyVolumeTrims)
+        locations.add (outputFile.withFileExtension (".levels.tsv"));
+
+    if(writePreloadManifest)
+        locations.add (outputFile.withFileExtension (".preload"));
+
+    return locations;
+}
+
+juce::Result convertPreset (const ConversionOptions& options, ConversionContext& context,
+                            juce::Array<juce::File>* sampleFiles)
+{
+    PresetConversion conversion (options);
+
+    if(conversion.parse (context) && conversion.resolveSamples (context)) {
+        if(sampleFiles != nullptr)
+            *sampleFiles = conversion.getSampleFiles();
+
+        if(conversion.applyFixups (context) && conversion.serialise (context))
+            conversion.write (context);
+    }
+
+    return conversion.getResult();
+}
@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    ConversionJob.h
+
+    Converts one EXS file into one Decent Sampler preset.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CrossfadeBaker.h"
+#include "LevelAnalyser.h"
+#include "LoopRefinement.h"
+#include "PhysicalLayout.h"
+#include "PreloadManifest.h"
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleCollector.h"
+#include "SampleConsolidation.h"
+#include "SampleDeduplicator.h"
+#include "SampleTranscoder.h"
+#include "SilenceTrimmer.h"
+#include "SampleHeaderCache.h"
+#include "SampleIndex.h"
+#include <map>
+
+//==============================================================================
+/** Everything needed to convert a single EXS file. */
+struct ConversionOptions
+{
+    juce::File inputFile;
+    juce::File outputFile;
+
+    /** If this is set, the EXS file is read from here instead of from
+        inputFile. inputFile must still be given, as samples are searched for
+        next to where it would be.
+    */
+    const juce::MemoryBlock* inputData = nullptr;
+
+    /** If this is set, the preset is written here instead of to outputFile.
+        outputFile must still be given, as samples and reports are written
+        next to where it would be.
+    */
+    juce::OutputStream* outputStream = nullptr;
+
+    /** The optional [sample-directory] argument. If set, the preset will look
+        for its samples in this directory.
+    */
+    juce::String sampleDirectory;
+
+    /** Clamps loop points that fall outside their sample instead of only
+        warning about them.
+    */
+    bool fixLoops = false;
+
+    /** Points samples with identical audio at a single copy. */
+    bool deduplicateSamples = false;
+
+    /** Clones, links or copies every sample into sampleDirectory, next to the
+        output file.
+    */
+    bool collectSamples = false;
+
+    /** Packs the samples into one WAV file per preset or per group. */
+    ConsolidationScope consolidation = ConsolidationScope::none;
+
+    /** Orders the zones in each group by where their samples are on disk. */
+    bool physicalOrder = false;
+
+    /** Writes a .preload manifest of the preset's samples next to the output. */
+    bool writePreloadManifest = false;
+
+    /** Moves loop points to nearby points where the loop joins up cleanly. */
+    LoopRefinement loopRefinement = LoopRefinement::none;
+
+    /** How far, in frames, refinement may move a loop point. */
+    int loopSearchRadius = 256;
+
+    /** Renders loop crossfades into copies of the samples. */
+    bool bakeCrossfades = false;
+
+    /** Trims silence from the start and end of each zone. */
+    bool trimSilence = false;
+
+    /** Trims silence by writing trimmed copies of the samples, rather than
+        only setting each zone's start and end.
+    */
+    bool writeTrimmedFiles = false;
+
+    /** If this has a format name, every sample is converted to that format. */
+    TranscodeTarget transcodeTarget;
+
+    /** Measures every zone's levels and writes them to a .levels.tsv file next
+        to the output, warning about velocity layers that are out of order.
+    */
+    bool analyseLevels = false;
+
+    /** Sets volume trims that even out the levels within each velocity layer.
+        This implies analyseLevels.
+    */
+    bool applyVolumeTrims = false;
+
+    /** The folder that any samples the conversion writes go into, where the
+        output preset will look for them.
+    */
+    juce::File getSampleTargetDirectory() const;
+
+    /** Returns true if any of the options write sample files into
+        getSampleTargetDirectory().
+    */
+    bool writesSamples() const;
+
+    /** Every file, or folder of files, that the conversion can write. The
+        preset itself is left out when it goes to outputStream.
+    */
+    juce::Array<juce::File> getWrittenLocations() const;
+};
+
+//==============================================================================
+/** State shared by every conversion in a run. */
+struct ConversionContext
+{
+    struct Options
+    {
+        SampleIndex::Options index;
+
+        /** The number of threads used for per-sample work, or 0 for one per CPU. */
+        int numThreads = 0;
+
+        /** Where sample headers are kept between runs, or File() to not keep them. */
+        juce::File headerCacheFile;
+
+        /** The most file operations to run at once against any one device. */
+        int maxOperationsPerDevice = 4;
+
+        /** The most stat calls and directory listings to run at once against
+            any one device.
+        */
+        int maxMetadataOperationsPerDevice = 16;
+
+        /** The most sample files to have open at once, or 0 for no limit.
+            This applies to the whole process.
+        */
+        int maxOpenFiles = 256;
+
+        /** How much decoded audio transcoding can hold in memory at once. */
+        juce::int64 transcodeMemoryBudget = (juce::int64) 512 * 1024 * 1024;
+
+        /** The level below which the head and tail of a sample count as silence. */
+        float silenceThresholdDecibels = -60.0f;
+
+        /** Keeps the preset generated from each EXS file, so converting it again
+            only parses it if it has changed. For long-running processes.
+        */
+        bool keepParsedPresets = false;
+    };
+
+    explicit ConversionContext (const Options& options);
+
+    /** Returns the number of directory listings and stat calls made so far. */
+    juce::int64 getMetadataOperationCount() const;
+
+    /** Reports a problem that doesn't stop a conversion. */
+    void warn (const juce::String& message);
+
+    /** Returns the preset XML generated from an EXS file. If keepParsedPresets
+        is set, this is only regenerated when the file's size or modification
+        time has changed.
+
+        If exsData isn't null, the EXS file is read from it instead, and the
+        result isn't kept.
+    */
+    juce::String getPresetXml (const juce::File& exsFile, const juce::MemoryBlock* exsData = nullptr);
+
+    /** Starts a new run for a process that converts presets more than once,
+        such as watch mode. The sample index and header cache are kept, but
+        headers are checked against their files again, and everything the
+        stages remember about the files they wrote is forgotten.
+    */
+    void startNewRun();
+
+    ProfileStats stats;
+    DeviceThrottle metadataThrottle;
+    SampleIndex sampleIndex;
+    SampleHeaderCache headerCache;
+    SampleDeduplicator deduplicator { stats };
+    CrossfadeBaker crossfadeBaker { stats };
+    LevelAnalyser levelAnalyser { stats };
+    SampleCollector collector;
+    SampleTranscoder transcoder;
+    SilenceTrimmer silenceTrimmer;
+    juce::ThreadPool threadPool;
+
+private:
+    juce::String parseExsFile (const juce::File& exsFile);
+
+    struct ParsedPreset
+    {
+        juce::int64 size = 0;
+        juce::Time modificationTime;
+        juce::String xml;
+    };
+
+    const bool keepParsedPresets;
+
+    juce::CriticalSection warningLock, parsedPresetLock;
+    std::map<juce::String, ParsedPreset> parsedPresets;
+
+    JUCE_DECLARE_NON_COPYABLE (ConversionContext)
+};
+
+//==============================================================================
+/**
+    One preset part-way through being converted, split into the stages that
+    convertPreset() runs one after another. ConversionPipeline runs the same
+    stages for different presets at once, on separate threads.
+
+    Each stage returns false once the conversion has failed, and getResult()
+    then says why. Later stages mustn't be called after that.
+*/
+class PresetConversion
+{
+public:
+    explicit PresetConversion (const ConversionOptions& options);
+    virtual ~PresetConversion() = default;
+
+    /** Generates the preset XML from the EXS file and parses it. */
+    bool parse (ConversionContext& context);
+
+    /** Finds every sample file the preset refers to. */
+    bool resolveSamples (ConversionContext& context);
+
+    /** Probes the samples, then runs the loop, sample and layout stages the
+        options ask for and makes the sample paths relative.
+    */
+    bool applyFixups (ConversionContext& context);
+
+    /** Turns the preset into text, and frees the document. */
+    bool serialise (ConversionContext& context);
+
+    /** Writes the text to the output file or stream. */
+    bool write (ConversionContext& context);
+
+    /** Returns the sample files the preset refers to. Called between
+        resolveSamples() and applyFixups(), these are the files as they were
+        found, before any stage replaced them.
+    */
+    juce::Array<juce::File> getSampleFiles() const;
+
+    const juce::Result& getResult() const noexcept      { return result; }
+
+    const ConversionOptions options;
+
+private:
+    bool fail (const juce::Result& failure);
+
+    std::unique_ptr<PresetDocument> preset;
+    juce::String xml;
+    juce::Result result { juce::Result::ok() };
+
+    JUCE_DECLARE_NON_COPYABLE (PresetConversion)
+};
+
+//==============================================================================
+/** Converts options.inputFile and writes the result to options.outputFile.
+
+    If sampleFiles isn't null, it's set to the sample files the EXS file refers
+    to, once they've been hunted for and before any stage replaces them. Some
+    may not exist.
+*/
+juce::Result convertPreset (const ConversionOptions& options, ConversionContext& context,
+                            juce::Array<juce::File>* sampleFiles = nullptr);
+
+/** Finds the sample files that converting options.inputFile would use, as
+    convertPreset() reports them, without writing anything.
+*/
+juce::Result findPresetSamples (const ConversionOptions& options, ConversionContext& context,
+                                juce::Array<juce::File>& sampleFiles);
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    ConversionPipeline.cpp
+
+  ==============================================================================
+*/
+
+#include "ConversionPipeline.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//==============================================================================
+/** A bounded queue of presets between two stages, closed once every worker of
+    the stage before it has finished.
+*/
+class ConversionPipeline::Queue
+{
+public:
+    Queue (size_t maxLength, int numProducers)
+        : capacity (maxLength), numProducersLeft (numProducers)
+    {
+    }
+
+    void push (std::unique_ptr<PresetConversion> conversion)
+    {
+        std::unique_lock<std::mutex> ul (mutex);
+        spaceFreed.wait (ul, [this] { return items.size() < capacity; });
+        items.push_back (std::move (conversion));
+        ul.unlock();
+
+        itemAdded.notify_one();
+    }
+
+    /** Waits for a preset, or returns nullptr once the queue is closed and empty. */
+    std::unique_ptr<PresetConversion> pop()
+    {
+        std::unique_lock<std::mutex> ul (mutex);
+        itemAdded.wait (ul, [this] { return ! items.empty() || numProducersLeft == 0; });
+
+        if(items.empty())
+            return nullptr;
+
+        auto conversion = std::move (items.front());
+        items.pop_front();
+        ul.unlock();
+
+        spaceFreed.notify_one();
+        return conversion;
+    }
+
+    /** Called by each worker of the stage before, once it's done. */
+    void producerFinished()
+    {
+        {
+            std::lock_guard<std::mutex> lg (mutex);
+            --numProducersLeft;
+        }
+
+        itemAdded.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    int numProducersLeft;
+
+    std::mutex mutex;
+    std::condition_variable itemAdded, spaceFreed;
+    std::deque<std::unique_ptr<PresetConversion>> items;
+};
+
+//==============================================================================
+ConversionPipeline::ConversionPipeline (ConversionContext& c, const Options& options)
+    : context (c)
+{
+    auto atLeastOne = [] (int n) { return juce::jmax (1, n); };
+
+    stages = {
+        { &PresetConversion::parse,           atLeastOne (options.numParseWorkers) },
+        { &PresetConversion::resolveSamples,  atLeastOne (options.numResolveWorkers) },
+        { &PresetConversion::applyFixups,     options.numFixupWorkers > 0 ? options.numFixupWorkers : juce::SystemStats::getNumCpus() },
+        { &PresetConversion::serialise,       atLeastOne (options.numSerialiseWorkers) },
+        { &PresetConversion::write,           atLeastOne (options.numWriteWorkers) }
+    };
+}
+
+ConversionPipeline::~ConversionPipeline() = default;
+
+void ConversionPipeline::run (JobSource nextJob, JobSink jobFinished)
+{
+    // queues[i] feeds stages[i + 1]. Two presets per worker keeps each stage
+    // busy without letting much pile up in front of a slow one.
+    queues.clear();
+    for(size_t i = 1; i < stages.size(); ++i)
+        queues.push_back (std::make_unique<Queue> ((size_t) stages[i].numWorkers * 2, stages[i - 1].numWorkers));
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < stages.size(); ++i)
+        for(int j = 0; j < stages[i].numWorkers; ++j)
+            workers.emplace_back ([this, i, &nextJob, &jobFinished] { runWorker (i, nextJob, jobFinished); });
+
+    for(auto& worker : workers)
+        worker.join();
+
+    queues.clear();
+}
+
+void ConversionPipeline::cancel()
+{
+    isCancelled = true;
+}
+
+void ConversionPipeline::runWorker (size_t stageIndex, const JobSource& nextJob, const JobSink& jobFinished)
+{
+    auto& stage = stages[stageIndex];
+    const bool isFirst = stageIndex == 0, isLast = stageIndex == stages.size() - 1;
+
+    for(;;) {
+        auto conversion = isFirst ? nextJob() : queues[stageIndex - 1]->pop();
+        if(conversion == nullptr)
+            break;
+
+        // Dropped jobs are simply destroyed, so later stages still drain
+        // their queues and finish.
+        if(isCancelled && ! isLast) {
+            ++numDropped;
+            continue;
+        }
+
+        if(! ((*conversion).*stage.perform) (context) || isLast)
+            jobFinished (std::move (conversion));
+        else
+            queues[stageIndex]->push (std::move (conversion));
+    }
+
+    if(! isLast)
+        queues[stageIndex]->producerFinished();
+}
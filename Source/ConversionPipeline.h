@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    ConversionPipeline.h
+
+    Runs the stages of many conversions at once, each on its own threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConversionJob.h"
+#include <atomic>
+#include <functional>
+
+//==============================================================================
+/**
+    Converts presets in a pipeline, so that the I/O-heavy stages of some
+    overlap with the CPU-heavy stages of others:
+
+        parse -> resolve samples -> fixups -> serialise -> write
+
+    Each stage has its own number of worker threads, and passes presets on
+    through a short queue. A stage that gets ahead of the next one waits for
+    room in the queue, so at most a few presets are held between any two
+    stages. A preset that fails at any stage leaves the pipeline there.
+
+    Cancelling drops every preset that hasn't reached the write stage as soon
+    as its current stage is done, while those already waiting to be written
+    still are.
+*/
+class ConversionPipeline
+{
+public:
+    struct Options
+    {
+        int numParseWorkers = 2;
+        int numResolveWorkers = 4;
+
+        /** Sample probing, loop fixes and the optional sample stages. These
+            also use the context's thread pool for per-sample work.
+        */
+        int numFixupWorkers = 0;
+
+        int numSerialiseWorkers = 2;
+        int numWriteWorkers = 4;
+    };
+
+    /** Workers for the fixup stage default to one per CPU. */
+    ConversionPipeline (ConversionContext& context, const Options& options);
+    ~ConversionPipeline();
+
+    /** Called by the parse workers for the next preset to convert. Returns
+        nullptr once there are no more. Can be called from several threads
+        at once, and can wait for a preset.
+    */
+    using JobSource = std::function<std::unique_ptr<PresetConversion>()>;
+
+    /** Called with each preset as it leaves the pipeline, whether it was
+        written or failed. Can be called from several threads at once.
+    */
+    using JobSink = std::function<void (std::unique_ptr<PresetConversion>)>;
+
+    /** Runs until nextJob has run out of presets and every one of them has
+        left the pipeline.
+    */
+    void run (JobSource nextJob, JobSink jobFinished);
+
+    /** Stops run() as soon as the presets already being written are done.
+        Safe to call from any thread.
+    */
+    void cancel();
+
+    /** Returns the number of presets dropped by cancel(). */
+    int getNumDropped() const       { return numDropped; }
+
+private:
+    //==============================================================================
+    class Queue;
+
+    struct Stage
+    {
+        bool (PresetConversion::* perform) (ConversionContext&);
+        int numWorkers;
+    };
+
+    void runWorker (size_t stageIndex, const JobSource& nextJob, const JobSink& jobFinished);
+
+    ConversionContext& context;
+    std::vector<Stage> stages;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<bool> isCancelled { false };
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ConversionPipeline)
+};
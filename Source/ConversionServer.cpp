@@ -0,0 +1,361 @@
+/*
+  ==============================================================================
+
+    ConversionServer.cpp
+
+  ==============================================================================
+*/
+
+#include "ConversionServer.h"
+#include "JobDescription.h"
+#include <thread>
+
+#if ! JUCE_WINDOWS
+ #include <arpa/inet.h>
+ #include <netinet/in.h>
+ #include <signal.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    /** Requests longer than this are refused, rather than buffered forever. */
+    constexpr size_t maxRequestLength = 1024 * 1024;
+
+    juce::Result socketError (const juce::String& action)
+    {
+        return juce::Result::fail ("Couldn't " + action + ": " + juce::String (strerror (errno)));
+    }
+
+   #if ! JUCE_WINDOWS
+    bool sendAll (int connection, const void* data, size_t numBytes)
+    {
+        auto* bytes = static_cast<const char*> (data);
+
+        while(numBytes > 0) {
+            auto numSent = send (connection, bytes, numBytes, 0);
+            if(numSent < 0 && errno == EINTR)
+                continue;
+
+            if(numSent <= 0)
+                return false;
+
+            bytes += numSent;
+            numBytes -= (size_t) numSent;
+        }
+
+        return true;
+    }
+   #endif
+}
+
+//==============================================================================
+ConversionServer::ConversionServer (const ConversionOptions& d, ConversionContext& c, const Options& o)
+    : defaultOptions (d), context (c), options (o),
+      workers (o.numWorkers > 0 ? o.numWorkers : juce::SystemStats::getNumCpus())
+{
+}
+
+ConversionServer::~ConversionServer()
+{
+   #if ! JUCE_WINDOWS
+    if(listener >= 0)
+        close (listener);
+
+    if(socketFile != juce::File())
+        socketFile.deleteFile();
+   #endif
+}
+
+juce::Result ConversionServer::listenOnSocket (const juce::File& file)
+{
+   #if JUCE_WINDOWS
+    juce::ignoreUnused (file);
+    return juce::Result::fail ("serve isn't supported on Windows.");
+   #else
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    auto path = file.getFullPathName();
+    if(path.getNumBytesAsUTF8() >= sizeof (address.sun_path))
+        return juce::Result::fail ("The socket path \"" + path + "\" is too long.");
+
+    memcpy (address.sun_path, path.toRawUTF8(), path.getNumBytesAsUTF8());
+
+    // Only ever remove a socket, never a file someone pointed us at by mistake.
+    struct stat info;
+    if(lstat (path.toRawUTF8(), &info) == 0) {
+        if(! S_ISSOCK (info.st_mode))
+            return juce::Result::fail ("\"" + path + "\" already exists and isn't a socket.");
+
+        unlink (path.toRawUTF8());
+    }
+
+    listener = socket (AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0)
+        return socketError ("create a socket");
+
+    // The socket file is created with the umask's permissions, so narrow them
+    // for the bind, and again afterwards in case the umask was ignored, before
+    // anyone can connect.
+    auto previousMask = umask (0077);
+    auto bound = bind (listener, reinterpret_cast<const sockaddr*> (&address), sizeof (address));
+    umask (previousMask);
+
+    if(bound != 0)
+        return socketError ("bind to \"" + path + "\"");
+
+    if(chmod (path.toRawUTF8(), 0600) != 0)
+        return socketError ("restrict access to \"" + path + "\"");
+
+    if(listen (listener, SOMAXCONN) != 0)
+        return socketError ("listen on \"" + path + "\"");
+
+    socketFile = file;
+    return juce::Result::ok();
+   #endif
+}
+
+juce::Result ConversionServer::listenOnPort (int port)
+{
+   #if JUCE_WINDOWS
+    juce::ignoreUnused (port);
+    return juce::Result::fail ("serve isn't supported on Windows.");
+   #else
+    // Unlike the socket file, a port can be reached by every user on the machine.
+    if(options.token.isEmpty())
+        return juce::Result::fail ("Listening on a port needs a token.");
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons ((uint16_t) port);
+    address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    listener = socket (AF_INET, SOCK_STREAM, 0);
+    if(listener < 0)
+        return socketError ("create a socket");
+
+    int reuse = 1;
+    setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+
+    if(bind (listener, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) != 0)
+        return socketError ("bind to port " + juce::String (port));
+
+    if(listen (listener, SOMAXCONN) != 0)
+        return socketError ("listen on port " + juce::String (port));
+
+    return juce::Result::ok();
+   #endif
+}
+
+void ConversionServer::run()
+{
+   #if ! JUCE_WINDOWS
+    // A client that hangs up mid-response shouldn't take the server with it.
+    signal (SIGPIPE, SIG_IGN);
+
+    const auto maxConnections = juce::jmax (1, options.maxConnections);
+
+    for(;;) {
+        {
+            // Connections beyond the limit wait in the listen backlog.
+            std::unique_lock<std::mutex> sl (connectionLock);
+            connectionClosed.wait (sl, [&] { return numConnections < maxConnections; });
+        }
+
+        auto connection = accept (listener, nullptr, nullptr);
+        if(connection < 0) {
+            if(errno != EINTR && errno != ECONNABORTED)
+                juce::Thread::sleep (100);
+
+            continue;
+        }
+
+        context.stats.add ("serve.connections");
+
+        {
+            const std::lock_guard<std::mutex> sl (connectionLock);
+            ++numConnections;
+        }
+
+        std::thread ([this, connection]
+        {
+            serveConnection (connection);
+            close (connection);
+
+            const std::lock_guard<std::mutex> sl (connectionLock);
+            --numConnections;
+            connectionClosed.notify_one();
+        }).detach();
+    }
+   #endif
+}
+
+//==============================================================================
+void ConversionServer::serveConnection (int connection)
+{
+   #if JUCE_WINDOWS
+    juce::ignoreUnused (connection);
+   #else
+    std::string received;
+    char buffer[4096];
+
+    for(;;) {
+        auto endOfLine = received.find ('\n');
+
+        if(endOfLine == std::string::npos) {
+            if(received.size() > maxRequestLength) {
+                juce::String error ("{\"ok\": false, \"error\": \"The request is too long.\"}\n");
+                sendAll (connection, error.toRawUTF8(), error.getNumBytesAsUTF8());
+                return;
+            }
+
+            auto numRead = recv (connection, buffer, sizeof (buffer), 0);
+            if(numRead < 0 && errno == EINTR)
+                continue;
+
+            if(numRead <= 0)
+                return;
+
+            received.append (buffer, (size_t) numRead);
+            continue;
+        }
+
+        auto line = juce::String::fromUTF8 (received.data(), (int) endOfLine).trim();
+        received.erase (0, endOfLine + 1);
+
+        if(line.isEmpty())
+            continue;
+
+        juce::MemoryOutputStream preset;
+        auto response = handleRequest (line, preset) + "\n";
+
+        if(! sendAll (connection, response.toRawUTF8(), response.getNumBytesAsUTF8())
+            || ! sendAll (connection, preset.getData(), preset.getDataSize()))
+            return;
+    }
+   #endif
+}
+
+juce::String ConversionServer::handleRequest (const juce::String& line, juce::MemoryOutputStream& preset)
+{
+    const auto receivedTime = juce::Time::getMillisecondCounterHiRes();
+    context.stats.add ("serve.requests");
+
+    auto json = juce::JSON::parse (line);
+    auto job = defaultOptions;
+    auto result = readJobDescription (json, juce::File::getCurrentWorkingDirectory(), job);
+
+    // Without an output, the preset goes back to the client. Anything written
+    // alongside it goes next to the EXS file.
+    const bool returnPreset = job.outputFile == juce::File();
+    if(returnPreset) {
+        job.outputFile = job.inputFile.withFileExtension (".dspreset");
+        job.outputStream = &preset;
+    }
+
+    if(result.wasOk())
+        result = checkRequest (json, job);
+
+    auto startTime = receivedTime, endTime = receivedTime;
+
+    if(result.wasOk()) {
+        if((bool) json["rescan"]) {
+            auto searchDirectory = job.inputFile.getParentDirectory();
+            context.sampleIndex.invalidate (searchDirectory, true);
+
+            if(job.sampleDirectory.isNotEmpty())
+                context.sampleIndex.invalidate (searchDirectory.getChildFile (job.sampleDirectory), true);
+        }
+
+        juce::WaitableEvent finished;
+
+        workers.addJob ([&]
+        {
+            startTime = juce::Time::getMillisecondCounterHiRes();
+            result = convert (job);
+            endTime = juce::Time::getMillisecondCounterHiRes();
+            finished.signal();
+        });
+
+        finished.wait();
+    }
+
+    auto* response = new juce::DynamicObject();
+    juce::var responseVar (response);
+
+    if(json.hasProperty ("id"))
+        response->setProperty ("id", json["id"]);
+
+    response->setProperty ("ok", result.wasOk());
+
+    if(result.failed()) {
+        preset.reset();
+        response->setProperty ("error", result.getErrorMessage());
+        context.stats.add ("serve.failures");
+    } else if(returnPreset) {
+        response->setProperty ("bytes", (juce::int64) preset.getDataSize());
+    } else {
+        response->setProperty ("output", job.outputFile.getFullPathName());
+    }
+
+    const auto now = juce::Time::getMillisecondCounterHiRes();
+    response->setProperty ("queuedMs", startTime - receivedTime);
+    response->setProperty ("convertMs", endTime - startTime);
+    response->setProperty ("totalMs", now - receivedTime);
+
+    return juce::JSON::toString (responseVar, true, 2);
+}
+
+juce::Result ConversionServer::checkRequest (const juce::var& json, const ConversionOptions& job) const
+{
+    if(options.token.isNotEmpty()) {
+        // Compared in full whatever the contents, so timing doesn't give it away.
+        auto given = json["token"].toString();
+        bool matches = given.length() == options.token.length();
+
+        for(int i = 0; i < options.token.length(); ++i)
+            matches &= given[i] == options.token[i];
+
+        if(! matches) {
+            context.stats.add ("serve.unauthorised");
+            return juce::Result::fail ("The job's token is missing or wrong.");
+        }
+    }
+
+    if(options.outputRoot == juce::File())
+        return juce::Result::ok();
+
+    // Everything the job can write is checked, including the samples and
+    // reports written next to a preset that is sent back rather than saved.
+    for(auto& location : job.getWrittenLocations())
+        if(location != options.outputRoot && ! location.isAChildOf (options.outputRoot))
+            return juce::Result::fail ("The job would write \"" + location.getFullPathName() + "\", outside \""
+                                        + options.outputRoot.getFullPathName() + "\".");
+
+    return juce::Result::ok();
+}
+
+juce::Result ConversionServer::convert (const ConversionOptions& job)
+{
+    {
+        // Nothing else is running, so nothing can be relying on the state this forgets.
+        const juce::ScopedLock sl (runLock);
+        if(numActiveJobs++ == 0)
+            context.startNewRun();
+    }
+
+    auto result = convertPreset (job, context);
+
+    // The server is usually stopped by a signal, so the header cache is saved
+    // whenever it goes idle rather than on exit.
+    const juce::ScopedLock sl (runLock);
+    if(--numActiveJobs == 0)
+        context.headerCache.save();
+
+    return result;
+}
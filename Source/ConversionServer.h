@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    ConversionServer.h
+
+    Converts presets on request over a local socket.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConversionJob.h"
+#include <condition_variable>
+
+//==============================================================================
+/**
+    The serve command: a long-running converter for other programs on the same
+    machine, so they don't pay for starting a process, and re-reading every
+    sample folder, for each preset.
+
+    Clients connect to a Unix domain socket, or a port on 127.0.0.1, and send
+    one job per line as JSON, in the form read by readJobDescription(), plus
+    optional "id" and "rescan" fields. Each job gets one line of JSON back:
+
+        { "id": 7, "ok": true, "bytes": 48213, "queuedMs": 0.1, "convertMs": 35.2, "totalMs": 35.4 }
+
+    If the job has no "output", the preset isn't written to disk: "bytes"
+    gives its length, and exactly that many bytes of preset XML follow the
+    line. Otherwise the response gives the "output" path it was written to.
+    A failed job gets "ok": false and an "error" message instead, with nothing
+    following it. "rescan": true makes the job list the folders below its EXS
+    file again, for when samples have been added since the server started.
+
+    Jobs from every connection run on one pool of workers and share the
+    ConversionContext, so the sample index and header cache stay warm. The
+    stages' per-run state is reset whenever a job starts with no others
+    running. A connection's responses come back in the order it sent the
+    jobs; clients that want jobs converted in parallel open more connections,
+    up to Options::maxConnections at once. Further connections wait in the
+    listen backlog until one closes.
+
+    The socket file is only accessible to the user running the server. Any
+    process on the machine can reach a TCP port, so a port needs a token,
+    which every job must give in a "token" field. Options::outputRoot, if set,
+    refuses jobs that would write anything outside that folder.
+
+    Only available on Linux and macOS.
+*/
+class ConversionServer
+{
+public:
+    struct Options
+    {
+        /** The most jobs to convert at once, across every connection. 0 means one per CPU. */
+        int numWorkers = 0;
+
+        /** The most connections served at once, each of which has a thread. */
+        int maxConnections = 64;
+
+        /** If not empty, jobs without this in their "token" field are refused. */
+        juce::String token;
+
+        /** If set, jobs that would write outside this folder are refused. */
+        juce::File outputRoot;
+    };
+
+    /** Jobs start from these options before their JSON is applied. */
+    ConversionServer (const ConversionOptions& defaultOptions, ConversionContext& context, const Options& options);
+    ~ConversionServer();
+
+    /** Listens on a Unix domain socket, replacing any socket file a previous
+        server left behind. Only the current user can connect to it.
+    */
+    juce::Result listenOnSocket (const juce::File& socketFile);
+
+    /** Listens on a TCP port on the loopback interface. Fails unless a token
+        has been set.
+    */
+    juce::Result listenOnPort (int port);
+
+    /** Accepts connections and serves them, each on its own thread. Never returns. */
+    void run();
+
+private:
+    void serveConnection (int connection);
+    juce::String handleRequest (const juce::String& line, juce::MemoryOutputStream& preset);
+    juce::Result checkRequest (const juce::var& json, const ConversionOptions& job) const;
+    juce::Result convert (const ConversionOptions& job);
+
+    const ConversionOptions defaultOptions;
+    ConversionContext& context;
+    const Options options;
+    juce::ThreadPool workers;
+    int listener = -1;
+    juce::File socketFile;
+
+    juce::CriticalSection runLock;
+    int numActiveJobs = 0;
+
+    std::mutex connectionLock;
+    std::condition_variable connectionClosed;
+    int numConnections = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ConversionServer)
+};
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    CrossfadeBaker.cpp
+
+  ==============================================================================
+*/
+
+#include "CrossfadeBaker.h"
+#include "AudioFiles.h"
+#include "LoopPoints.h"
+#include "ParallelFor.h"
+
+//==============================================================================
+namespace
+{
+    int getOutputBitDepth (const SampleHeader& header)
+    {
+        if(header.isFloatingPoint || header.bitsPerSample > 24)
+            return 32;
+
+        return header.bitsPerSample > 16 ? 24 : 16;
+    }
+}
+
+//==============================================================================
+CrossfadeBaker::CrossfadeBaker (ProfileStats& s)
+    : stats (s)
+{
+}
+
+juce::Result CrossfadeBaker::bake (PresetDocument& preset, SampleHeaderCache& headers,
+                                   const juce::File& targetDirectory, juce::ThreadPool& pool)
+{
+    std::map<juce::String, BakedLoop> loopsByTarget;
+    std::map<juce::XmlElement*, juce::File> bakedFiles;
+    TargetClaims::Request request;
+
+    for(auto* sample : preset.getSamples()) {
+        if(! sample->getBoolAttribute ("loopEnabled", true) || sample->getIntAttribute ("loopCrossfade") <= 0)
+            continue;
+
+        BakedLoop loop;
+        loop.source = preset.getSampleFile (*sample);
+
+        auto header = headers.getHeader (loop.source);
+        if(! header.isValid || ! getZoneLoop (*sample, header, loop.loopStart, loop.loopEnd)
+            || loop.loopEnd <= loop.loopStart || loop.loopEnd >= header.lengthInSamples) {
+            stats.add ("crossfades.notBaked");
+            continue;
+        }
+
+        // The crossfade reads the frames before the loop start, so it can't be longer than that lead-in.
+        loop.crossfade = (int) juce::jmin ((juce::int64) sample->getIntAttribute ("loopCrossfade"),
+                                           loop.loopStart, loop.loopEnd - loop.loopStart);
+        if(loop.crossfade <= 0) {
+            stats.add ("crossfades.notBaked");
+            continue;
+        }
+
+        loop.target = targetDirectory.getChildFile (loop.source.getFileNameWithoutExtension()
+                                                     + "-xf-" + juce::String (loop.loopStart) + "-" + juce::String (loop.loopEnd)
+                                                     + "-" + juce::String (loop.crossfade) + ".wav");
+
+        // Zones playing the same loop of the same file share one copy.
+        request.add (loop.target, loop.source);
+        loopsByTarget.emplace (loop.target.getFullPathName(), loop);
+        bakedFiles[sample] = loop.target;
+    }
+
+    if(bakedFiles.empty())
+        return juce::Result::ok();
+
+    auto created = targetDirectory.createDirectory();
+    if(created.failed())
+        return juce::Result::fail ("Couldn't create \"" + targetDirectory.getFullPathName() + "\": " + created.getErrorMessage());
+
+    auto claimed = claims.claim (request, "baked to");
+    if(claimed.failed())
+        return claimed;
+
+    juce::StringArray errors;
+    juce::CriticalSection errorLock;
+
+    // Copies claimed by an earlier preset in this run are written by it.
+    parallelFor (pool, request.size(), [&] (int i)
+    {
+        if(! request.isOwner (i))
+            return;
+
+        auto& loop = loopsByTarget.at (request.getTarget (i).getFullPathName());
+        auto result = renderLoop (loop, headers.getHeader (loop.source));
+        request.finish (i, result);
+
+        if(result.failed()) {
+            const juce::ScopedLock sl (errorLock);
+            errors.add (result.getErrorMessage());
+        }
+    });
+
+    if(! errors.isEmpty())
+        return juce::Result::fail (errors.joinIntoString ("\n"));
+
+    // Zones are only pointed at copies that were actually written.
+    auto waited = request.waitForOthers();
+    if(waited.failed())
+        return waited;
+
+    for(auto& [sample, file] : bakedFiles) {
+        writeEmbeddedLoopAttributes (*sample, headers.getHeader (preset.getSampleFile (*sample)));
+        sample->removeAttribute ("loopCrossfade");
+        sample->removeAttribute ("loopCrossfadeMode");
+        preset.setSampleFile (*sample, file);
+        stats.add ("crossfades.baked");
+    }
+
+    return juce::Result::ok();
+}
+
+void CrossfadeBaker::startNewRun()
+{
+    claims.clear();
+}
+
+juce::Result CrossfadeBaker::renderLoop (const BakedLoop& loop, const SampleHeader& header)
+{
+    if(loop.target.existsAsFile() && loop.target.getLastModificationTime() >= loop.source.getLastModificationTime()) {
+        stats.add ("crossfades.upToDate");
+        return juce::Result::ok();
+    }
+
+    auto reader = createSampleReader (loop.source);
+    if(reader == nullptr)
+        return juce::Result::fail ("Couldn't read \"" + loop.source.getFullPathName() + "\".");
+
+    const auto numChannels = (int) reader->numChannels;
+    const auto crossfade = loop.crossfade;
+    const auto fadeStart = loop.loopEnd + 1 - crossfade;
+
+    // The end of the loop fades out while the lead-in to the loop start fades in.
+    juce::AudioBuffer<float> loopTail (numChannels, crossfade), leadIn (numChannels, crossfade);
+    if(! reader->read (&loopTail, 0, crossfade, fadeStart, true, true)
+        || ! reader->read (&leadIn, 0, crossfade, loop.loopStart - crossfade, true, true))
+        return juce::Result::fail ("Couldn't read \"" + loop.source.getFullPathName() + "\".");
+
+    std::vector<float> fadeOut ((size_t) crossfade), fadeIn ((size_t) crossfade);
+    for(int i = 0; i < crossfade; ++i) {
+        auto angle = juce::MathConstants<float>::halfPi * (float) (i + 1) / (float) crossfade;
+        fadeOut[(size_t) i] = std::cos (angle);
+        fadeIn[(size_t) i] = std::sin (angle);
+    }
+
+    for(int channel = 0; channel < numChannels; ++channel) {
+        auto* tail = loopTail.getWritePointer (channel);
+        juce::FloatVectorOperations::multiply (tail, fadeOut.data(), crossfade);
+        juce::FloatVectorOperations::addWithMultiply (tail, leadIn.getReadPointer (channel), fadeIn.data(), crossfade);
+    }
+
+    auto cantWrite = juce::Result::fail ("Couldn't write \"" + loop.target.getFullPathName() + "\".");
+    juce::TemporaryFile temp (loop.target);
+
+    {
+        juce::WavAudioFormat wav;
+        auto writer = createSampleWriter (temp.getFile(), wav, reader->sampleRate, numChannels,
+                                          getOutputBitDepth (header), header.isFloatingPoint);
+
+        if(writer == nullptr
+            || ! writer->writeFromAudioReader (*reader, 0, fadeStart)
+            || ! writer->writeFromAudioSampleBuffer (loopTail, 0, crossfade)
+            || ! writer->writeFromAudioReader (*reader, loop.loopEnd + 1, reader->lengthInSamples - loop.loopEnd - 1))
+            return cantWrite;
+    }
+
+    if(! temp.overwriteTargetFileWithTemporary())
+        return cantWrite;
+
+    stats.add ("crossfades.filesWritten");
+    return juce::Result::ok();
+}
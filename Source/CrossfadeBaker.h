@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    CrossfadeBaker.h
+
+    Renders loop crossfades into the sample files.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+#include "TargetClaims.h"
+#include <map>
+
+//==============================================================================
+/**
+    Bakes each zone's loop crossfade into a copy of its sample, so that Decent
+    Sampler can play the loop without crossfading in real time.
+
+    The last loopCrossfade frames of the loop are mixed with equal-power gain
+    curves into the frames that lead up to the loop start, so the audio before
+    the jump back ends exactly as the audio before the loop start does. The
+    mixing runs on JUCE's vectorised FloatVectorOperations, and the rest of
+    the sample is streamed through unchanged.
+
+    Each distinct loop of a file gets its own copy, named after the source and
+    the loop, so zones that share a loop share a copy and unchanged copies
+    are reused between runs. A copy another preset is writing is waited for,
+    and the preset fails if it couldn't be written. The zones lose their
+    loopCrossfade attribute. A crossfade longer than the audio before the loop
+    start is shortened to fit. All methods are thread-safe.
+*/
+class CrossfadeBaker
+{
+public:
+    explicit CrossfadeBaker (ProfileStats& stats);
+
+    /** Bakes the crossfades of every zone in the preset, writing the copies to
+        targetDirectory in parallel.
+    */
+    juce::Result bake (PresetDocument& preset, SampleHeaderCache& headers,
+                       const juce::File& targetDirectory, juce::ThreadPool& pool);
+
+    /** Forgets which copies were written this run, so their sources are
+        checked again the next time they're baked.
+    */
+    void startNewRun();
+
+private:
+    struct BakedLoop
+    {
+        juce::File source, target;
+        juce::int64 loopStart = 0, loopEnd = 0;
+        int crossfade = 0;
+    };
+
+    juce::Result renderLoop (const BakedLoop& loop, const SampleHeader& header);
+
+    ProfileStats& stats;
+
+    TargetClaims claims;
+
+    JUCE_DECLARE_NON_COPYABLE (CrossfadeBaker)
+};
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    DeviceThrottle.cpp
+
+  ==============================================================================
+*/
+
+#include "DeviceThrottle.h"
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+#endif
+
+//==============================================================================
+DeviceThrottle::DeviceThrottle (int maxOperations)
+    : maxOperationsPerDevice (juce::jmax (1, maxOperations))
+{
+}
+
+void DeviceThrottle::acquire (juce::uint64 device)
+{
+    std::unique_lock<std::mutex> ul (mutex);
+    slotFreed.wait (ul, [&] { return operationsInFlight[device] < maxOperationsPerDevice; });
+    ++operationsInFlight[device];
+}
+
+void DeviceThrottle::release (juce::uint64 device)
+{
+    {
+        std::lock_guard<std::mutex> lg (mutex);
+        --operationsInFlight[device];
+    }
+
+    slotFreed.notify_all();
+}
+
+juce::uint64 DeviceThrottle::getDeviceFor (const juce::File& file)
+{
+   #if JUCE_WINDOWS
+    juce::ignoreUnused (file);
+    return 0;
+   #else
+    struct stat info;
+    if(stat (file.getFullPathName().toRawUTF8(), &info) != 0)
+        return 0;
+
+    return (juce::uint64) info.st_dev;
+   #endif
+}
+
+juce::uint64 DeviceThrottle::getDeviceForDirectory (const juce::File& directory, ProfileStats& stats)
+{
+    const auto key = directory.getFullPathName();
+    juce::uint64 nearestKnownDevice = 0;
+    {
+        std::lock_guard<std::mutex> lg (mutex);
+        auto existing = directoryDevices.find (key);
+        if(existing != directoryDevices.end())
+            return existing->second;
+
+        // Usually a mount point is further up than any directory seen so far,
+        // so the parent's device is the best guess at which one this stat hits.
+        for(auto parent = directory; parent != parent.getParentDirectory();) {
+            parent = parent.getParentDirectory();
+
+            auto known = directoryDevices.find (parent.getFullPathName());
+            if(known != directoryDevices.end()) {
+                nearestKnownDevice = known->second;
+                break;
+            }
+        }
+    }
+
+   #if JUCE_WINDOWS
+    juce::ignoreUnused (stats, nearestKnownDevice);
+    auto device = getDeviceFor (directory);
+   #else
+    juce::uint64 device;
+    {
+        // Looked up outside the lock, as this stat is itself a metadata operation.
+        const ScopedSlot slot (*this, nearestKnownDevice, nearestKnownDevice);
+        stats.add ("metadata.stats");
+        device = getDeviceFor (directory);
+    }
+   #endif
+
+    rememberDevice (directory, device);
+    return device;
+}
+
+void DeviceThrottle::rememberDevice (const juce::File& directory, juce::uint64 device)
+{
+    std::lock_guard<std::mutex> lg (mutex);
+    directoryDevices[directory.getFullPathName()] = device;
+}
+
+// Slots are always taken in device order, so two operations can't each be
+// holding the slot the other is waiting for.
+DeviceThrottle::ScopedSlot::ScopedSlot (DeviceThrottle& t, juce::uint64 firstDevice, juce::uint64 secondDevice)
+    : throttle (t), lowerDevice (juce::jmin (firstDevice, secondDevice)), higherDevice (juce::jmax (firstDevice, secondDevice))
+{
+    throttle.acquire (lowerDevice);
+    if(higherDevice != lowerDevice)
+        throttle.acquire (higherDevice);
+}
+
+DeviceThrottle::ScopedSlot::~ScopedSlot()
+{
+    if(higherDevice != lowerDevice)
+        throttle.release (higherDevice);
+    throttle.release (lowerDevice);
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    DeviceThrottle.h
+
+    Limits how many file operations run at once against each storage device.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProfileStats.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+//==============================================================================
+/**
+    Limits how many operations run at once against each storage device, so
+    that a parallel run doesn't swamp a single disk or NAS.
+*/
+class DeviceThrottle
+{
+public:
+    explicit DeviceThrottle (int maxOperationsPerDevice);
+
+    /** Waits until there's a free slot on the device, then takes it. */
+    void acquire (juce::uint64 device);
+
+    /** Gives back a slot taken by acquire(). */
+    void release (juce::uint64 device);
+
+    /** Returns an id for the device a file lives on. */
+    static juce::uint64 getDeviceFor (const juce::File& file);
+
+    /** Returns an id for the device a directory lives on, only looking it up
+        the first time each directory is asked about. Files are assumed to be
+        on the same device as their directory.
+
+        The lookup is a stat call, so it's counted as "metadata.stats" and
+        takes a slot on the device of the nearest parent directory already
+        known, or on device 0 if there's none.
+    */
+    juce::uint64 getDeviceForDirectory (const juce::File& directory, ProfileStats& stats);
+
+    /** Records the device a directory lives on, found by something that had to
+        look at the directory anyway, so getDeviceForDirectory() needn't.
+    */
+    void rememberDevice (const juce::File& directory, juce::uint64 device);
+
+    //==============================================================================
+    /** Holds a slot on up to two devices for as long as it exists. */
+    class ScopedSlot
+    {
+    public:
+        ScopedSlot (DeviceThrottle& throttle, juce::uint64 firstDevice, juce::uint64 secondDevice);
+        ~ScopedSlot();
+
+    private:
+        DeviceThrottle& throttle;
+        juce::uint64 lowerDevice, higherDevice;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedSlot)
+    };
+
+private:
+    const int maxOperationsPerDevice;
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::map<juce::uint64, int> operationsInFlight;
+    std::map<juce::String, juce::uint64> directoryDevices;
+
+    JUCE_DECLARE_NON_COPYABLE (DeviceThrottle)
+};
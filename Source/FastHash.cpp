@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    FastHash.cpp
+
+  ==============================================================================
+*/
+
+#include "FastHash.h"
+#include "OpenFileLimit.h"
+
+//==============================================================================
+namespace
+{
+    constexpr juce::uint64 prime1 = 0x9e3779b185ebca87ULL;
+    constexpr juce::uint64 prime2 = 0xc2b2ae3d27d4eb4fULL;
+    constexpr juce::uint64 prime3 = 0x165667b19e3779f9ULL;
+    constexpr juce::uint64 prime4 = 0x85ebca77c2b2ae63ULL;
+    constexpr juce::uint64 prime5 = 0x27d4eb2f165667c5ULL;
+
+    inline juce::uint64 rotateLeft (juce::uint64 value, int bits) noexcept
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline juce::uint64 read64 (const juce::uint8* data) noexcept
+    {
+        juce::uint64 value;
+        memcpy (&value, data, sizeof (value));
+        return juce::ByteOrder::isBigEndian() ? juce::ByteOrder::swap (value) : value;
+    }
+
+    inline juce::uint32 read32 (const juce::uint8* data) noexcept
+    {
+        juce::uint32 value;
+        memcpy (&value, data, sizeof (value));
+        return juce::ByteOrder::isBigEndian() ? juce::ByteOrder::swap (value) : value;
+    }
+
+    inline juce::uint64 round (juce::uint64 accumulator, juce::uint64 input) noexcept
+    {
+        accumulator += input * prime2;
+        return rotateLeft (accumulator, 31) * prime1;
+    }
+
+    inline juce::uint64 mergeRound (juce::uint64 hash, juce::uint64 accumulator) noexcept
+    {
+        hash ^= round (0, accumulator);
+        return hash * prime1 + prime4;
+    }
+}
+
+//==============================================================================
+FastHash::FastHash (juce::uint64 s) noexcept
+    : accumulators { s + prime1 + prime2, s + prime2, s, s - prime1 }, seed (s)
+{
+}
+
+void FastHash::update (const void* data, size_t numBytes) noexcept
+{
+    auto* input = static_cast<const juce::uint8*> (data);
+    totalLength += numBytes;
+
+    if(bufferedBytes + numBytes < sizeof (buffer)) {
+        memcpy (buffer + bufferedBytes, input, numBytes);
+        bufferedBytes += numBytes;
+        return;
+    }
+
+    if(bufferedBytes > 0) {
+        auto toCopy = sizeof (buffer) - bufferedBytes;
+        memcpy (buffer + bufferedBytes, input, toCopy);
+        input += toCopy;
+        numBytes -= toCopy;
+
+        for(int lane = 0; lane < 4; ++lane)
+            accumulators[lane] = round (accumulators[lane], read64 (buffer + lane * 8));
+
+        bufferedBytes = 0;
+    }
+
+    for(; numBytes >= 32; input += 32, numBytes -= 32)
+        for(int lane = 0; lane < 4; ++lane)
+            accumulators[lane] = round (accumulators[lane], read64 (input + lane * 8));
+
+    memcpy (buffer, input, numBytes);
+    bufferedBytes = numBytes;
+}
+
+juce::uint64 FastHash::getHash() const noexcept
+{
+    juce::uint64 hash;
+
+    if(totalLength >= 32) {
+        hash = rotateLeft (accumulators[0], 1) + rotateLeft (accumulators[1], 7)
+             + rotateLeft (accumulators[2], 12) + rotateLeft (accumulators[3], 18);
+
+        for(auto accumulator : accumulators)
+            hash = mergeRound (hash, accumulator);
+    } else {
+        hash = seed + prime5;
+    }
+
+    hash += totalLength;
+
+    auto* remaining = buffer;
+    auto numRemaining = bufferedBytes;
+
+    for(; numRemaining >= 8; remaining += 8, numRemaining -= 8) {
+        hash ^= round (0, read64 (remaining));
+        hash = rotateLeft (hash, 27) * prime1 + prime4;
+    }
+
+    if(numRemaining >= 4) {
+        hash ^= (juce::uint64) read32 (remaining) * prime1;
+        hash = rotateLeft (hash, 23) * prime2 + prime3;
+        remaining += 4;
+        numRemaining -= 4;
+    }
+
+    for(; numRemaining > 0; ++remaining, --numRemaining) {
+        hash ^= *remaining * prime5;
+        hash = rotateLeft (hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool FastHash::hashFile (const juce::File& file, juce::uint64& result)
+{
+    const OpenFileLimit::ScopedFile openFile;
+    juce::FileInputStream stream (file);
+    if(! stream.openedOk())
+        return false;
+
+    FastHash hash;
+    juce::HeapBlock<char> block (1 << 20);
+
+    for(;;) {
+        auto numRead = stream.read (block.get(), 1 << 20);
+        if(numRead < 0)
+            return false;
+        if(numRead == 0)
+            break;
+
+        hash.update (block.get(), (size_t) numRead);
+    }
+
+    result = hash.getHash();
+    return true;
+}
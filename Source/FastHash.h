@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    FastHash.h
+
+    A fast, non-cryptographic 64-bit hash for comparing file contents.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A streaming implementation of XXH64.
+
+    This is only good for spotting identical data, not for anything security
+    related, but it runs at several GB/s so hashing is limited by the disk.
+
+    @code
+    FastHash hash;
+    hash.update (data, numBytes);
+    auto value = hash.getHash();
+    @endcode
+*/
+class FastHash
+{
+public:
+    explicit FastHash (juce::uint64 seed = 0) noexcept;
+
+    /** Adds some more data. */
+    void update (const void* data, size_t numBytes) noexcept;
+
+    /** Returns the hash of everything added so far. */
+    juce::uint64 getHash() const noexcept;
+
+    /** Hashes a whole file, returning false if it couldn't be read. */
+    static bool hashFile (const juce::File& file, juce::uint64& result);
+
+private:
+    juce::uint64 accumulators[4];
+    juce::uint64 seed, totalLength = 0;
+    juce::uint8 buffer[32];
+    size_t bufferedBytes = 0;
+};
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    FolderWatcher.cpp
+
+  ==============================================================================
+*/
+
+#include "FolderWatcher.h"
+
+#if JUCE_LINUX
+ #include <poll.h>
+ #include <sys/inotify.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+juce::StringArray FolderWatcher::waitForChanges (int timeoutMilliseconds, int debounceMilliseconds)
+{
+    juce::StringArray changes;
+
+    if(readChanges (timeoutMilliseconds, changes))
+        while(readChanges (debounceMilliseconds, changes)) {}
+
+    return changes;
+}
+
+#if JUCE_LINUX
+//==============================================================================
+namespace
+{
+    // IN_CLOSE_WRITE rather than IN_MODIFY, so a file is reported once it has
+    // been saved rather than on every write.
+    constexpr uint32_t watchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+}
+
+FolderWatcher::FolderWatcher (int)
+    : inotifyHandle (inotify_init1 (IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    if(inotifyHandle >= 0)
+        close (inotifyHandle);
+}
+
+void FolderWatcher::watch (const juce::File& directory, bool recursive)
+{
+    if(inotifyHandle < 0)
+        return;
+
+    // inotify hands back the same descriptor for a directory it's already
+    // watching, however it was reached, which also stops symlink loops.
+    auto descriptor = inotify_add_watch (inotifyHandle, directory.getFullPathName().toRawUTF8(), watchMask);
+    if(descriptor < 0)
+        return;
+
+    auto& watched = watches[descriptor];
+    const bool wasRecursive = watched.isRecursive;
+
+    if(watched.path.isEmpty())
+        watched.path = directory.getFullPathName();
+
+    watched.isRecursive = wasRecursive || recursive;
+
+    if(recursive && ! wasRecursive)
+        for(auto& entry : juce::RangedDirectoryIterator (directory, false, "*", juce::File::findDirectories))
+            watch (entry.getFile(), true);
+}
+
+bool FolderWatcher::readChanges (int timeoutMilliseconds, juce::StringArray& changes)
+{
+    if(inotifyHandle < 0) {
+        juce::Thread::sleep (timeoutMilliseconds);
+        return false;
+    }
+
+    pollfd request { inotifyHandle, POLLIN, 0 };
+    if(poll (&request, 1, timeoutMilliseconds) <= 0)
+        return false;
+
+    alignas (inotify_event) char buffer[16384];
+    bool foundChanges = false;
+
+    for(;;) {
+        auto numBytes = read (inotifyHandle, buffer, sizeof (buffer));
+        if(numBytes <= 0)
+            break;
+
+        for(auto* position = buffer; position < buffer + numBytes;) {
+            auto* event = reinterpret_cast<const inotify_event*> (position);
+            position += sizeof (inotify_event) + event->len;
+
+            // Events were dropped, so anything could have changed.
+            if((event->mask & IN_Q_OVERFLOW) != 0) {
+                for(auto& watched : watches)
+                    changes.addIfNotAlreadyThere (watched.second.path);
+
+                foundChanges = true;
+                continue;
+            }
+
+            auto watched = watches.find (event->wd);
+            if(watched == watches.end())
+                continue;
+
+            if((event->mask & IN_IGNORED) != 0) {
+                watches.erase (watched);
+                continue;
+            }
+
+            auto path = event->len > 0 ? juce::File (watched->second.path).getChildFile (juce::String::fromUTF8 (event->name)).getFullPathName()
+                                       : watched->second.path;
+            changes.addIfNotAlreadyThere (path);
+            foundChanges = true;
+
+            if((event->mask & IN_ISDIR) != 0 && (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0 && watched->second.isRecursive)
+                watch (juce::File (path), true);
+        }
+    }
+
+    return foundChanges;
+}
+
+#else
+//==============================================================================
+FolderWatcher::FolderWatcher (int interval)
+    : pollIntervalMilliseconds (juce::jmax (1, interval))
+{
+}
+
+FolderWatcher::~FolderWatcher() {}
+
+void FolderWatcher::watch (const juce::File& directory, bool recursive)
+{
+    auto existing = watchedDirectories.find (directory.getFullPathName());
+    if(existing != watchedDirectories.end() && (existing->second || ! recursive))
+        return;
+
+    watchedDirectories[directory.getFullPathName()] = recursive;
+
+    // Files that are already there don't count as changes.
+    for(auto& entry : scan())
+        snapshot.insert (entry);
+}
+
+std::map<juce::String, FolderWatcher::Stamp> FolderWatcher::scan() const
+{
+    std::map<juce::String, Stamp> stamps;
+
+    // A directory's own stamp is left out, as it changes whenever anything is
+    // added to it; only its appearing or disappearing is reported.
+    for(auto& watched : watchedDirectories)
+        for(auto& entry : juce::RangedDirectoryIterator (juce::File (watched.first), watched.second, "*", juce::File::findFilesAndDirectories))
+            stamps[entry.getFile().getFullPathName()] = entry.isDirectory() ? Stamp() : Stamp { entry.getFileSize(), entry.getModificationTime() };
+
+    return stamps;
+}
+
+bool FolderWatcher::readChanges (int timeoutMilliseconds, juce::StringArray& changes)
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32) timeoutMilliseconds;
+
+    for(;;) {
+        auto current = scan();
+        bool foundChanges = false;
+
+        for(auto& entry : current) {
+            auto previous = snapshot.find (entry.first);
+            if(previous == snapshot.end() || ! (previous->second == entry.second)) {
+                changes.addIfNotAlreadyThere (entry.first);
+                foundChanges = true;
+            }
+        }
+
+        for(auto& entry : snapshot) {
+            if(current.count (entry.first) == 0) {
+                changes.addIfNotAlreadyThere (entry.first);
+                foundChanges = true;
+            }
+        }
+
+        snapshot = std::move (current);
+
+        auto now = juce::Time::getMillisecondCounter();
+        if(foundChanges || now >= deadline)
+            return foundChanges;
+
+        juce::Thread::sleep ((int) juce::jmin ((juce::uint32) pollIntervalMilliseconds, deadline - now));
+    }
+}
+#endif
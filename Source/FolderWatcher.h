@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    FolderWatcher.h
+
+    Reports the files and directories that change below a set of folders.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+/**
+    Watches directories for files being created, saved, deleted or moved.
+
+    On Linux this uses inotify, with one watch per directory; recursive
+    watches pick up directories created after they were added. Elsewhere the
+    directories are rescanned every pollIntervalMilliseconds and compared by
+    size and modification time.
+
+    Changes are debounced: once something has changed, waitForChanges()
+    carries on collecting changes until things have been quiet for a while, so
+    an editor's save sequence, or a folder of samples being copied in, comes
+    back as one batch.
+*/
+class FolderWatcher
+{
+public:
+    static constexpr int defaultPollIntervalMilliseconds = 1000;
+
+    /** The poll interval is only used where changes are found by rescanning. */
+    explicit FolderWatcher (int pollIntervalMilliseconds = defaultPollIntervalMilliseconds);
+    ~FolderWatcher();
+
+    /** Starts watching a directory, and if recursive is true every directory
+        below it. Watching a directory again does nothing.
+    */
+    void watch (const juce::File& directory, bool recursive);
+
+    /** Waits up to timeoutMilliseconds for something to change, then keeps
+        collecting changes until there have been none for debounceMilliseconds.
+        Returns the paths that were created, saved, deleted or moved, or nothing
+        if the wait timed out. A directory path means anything below it may
+        have changed.
+    */
+    juce::StringArray waitForChanges (int timeoutMilliseconds, int debounceMilliseconds);
+
+private:
+    /** Adds any changes seen within timeoutMilliseconds, returning true if there were some. */
+    bool readChanges (int timeoutMilliseconds, juce::StringArray& changes);
+
+   #if JUCE_LINUX
+    struct Watch
+    {
+        juce::String path;
+        bool isRecursive = false;
+    };
+
+    int inotifyHandle = -1;
+    std::map<int, Watch> watches;
+   #else
+    struct Stamp
+    {
+        juce::int64 size = 0;
+        juce::Time modificationTime;
+
+        bool operator== (const Stamp& other) const   { return size == other.size && modificationTime == other.modificationTime; }
+    };
+
+    std::map<juce::String, Stamp> scan() const;
+
+    const int pollIntervalMilliseconds;
+    std::map<juce::String, bool> watchedDirectories;
+    std::map<juce::String, Stamp> snapshot;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (FolderWatcher)
+};
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    GlobMatcher.cpp
+
+  ==============================================================================
+*/
+
+#include "GlobMatcher.h"
+
+//==============================================================================
+static std::unique_ptr<std::regex> compileAlternatives (const juce::StringArray& regexes)
+{
+    if(regexes.isEmpty())
+        return nullptr;
+
+    auto combined = "^(?:" + regexes.joinIntoString (")$|^(?:") + ")$";
+    return std::make_unique<std::regex> (combined.toStdString(),
+                                         std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+}
+
+static juce::String normalisePattern (const juce::String& pattern)
+{
+    return pattern.trim().replaceCharacter ('\\', '/').trimCharactersAtEnd ("/");
+}
+
+//==============================================================================
+GlobMatcher::GlobMatcher (const juce::StringArray& patterns)
+{
+    juce::StringArray nameRegexes, pathRegexes;
+
+    for(auto pattern : patterns) {
+        pattern = normalisePattern (pattern);
+        if(pattern.isEmpty() || checkPattern (pattern).failed())
+            continue;
+
+        if(pattern.containsChar ('/'))
+            pathRegexes.add (globToRegex (pattern.trimCharactersAtStart ("/")));
+        else
+            nameRegexes.add (globToRegex (pattern));
+    }
+
+    nameMatcher = compileAlternatives (nameRegexes);
+    pathMatcher = compileAlternatives (pathRegexes);
+}
+
+bool GlobMatcher::matches (const juce::String& name, const juce::String& relativePath) const
+{
+    if(nameMatcher != nullptr && std::regex_match (name.toStdString(), *nameMatcher))
+        return true;
+
+    return pathMatcher != nullptr && std::regex_match (relativePath.toStdString(), *pathMatcher);
+}
+
+juce::Result GlobMatcher::checkPattern (const juce::String& pattern)
+{
+    try {
+        std::regex (globToRegex (normalisePattern (pattern).trimCharactersAtStart ("/")).toStdString(),
+                    std::regex::ECMAScript | std::regex::icase);
+    } catch (const std::regex_error&) {
+        return juce::Result::fail ("\"" + pattern + "\" isn't a valid glob pattern.");
+    }
+
+    return juce::Result::ok();
+}
+
+juce::String GlobMatcher::globToRegex (const juce::String& glob)
+{
+    juce::String regex;
+
+    for(int i = 0; i < glob.length(); ++i) {
+        auto c = glob[i];
+
+        if(c == '*') {
+            if(glob[i + 1] == '*') {
+                // "**/" also matches no folders at all.
+                if(glob[i + 2] == '/') {
+                    regex << "(?:.*/)?";
+                    i += 2;
+                } else {
+                    regex << ".*";
+                    ++i;
+                }
+            } else {
+                regex << "[^/]*";
+            }
+        } else if(c == '?') {
+            regex << "[^/]";
+        } else if(c == '[') {
+            auto close = glob.indexOfChar (i + 1, ']');
+            if(close < 0) {
+                regex << "\\[";
+            } else {
+                auto set = glob.substring (i + 1, close);
+                if(set.startsWithChar ('!'))
+                    set = "^" + set.substring (1);
+
+                regex << "[" << set.replace ("\\", "\\\\") << "]";
+                i = close;
+            }
+        } else {
+            if(juce::String ("\\^$.|+()[]{}").containsChar (c))
+                regex << "\\";
+
+            regex << juce::String::charToString (c);
+        }
+    }
+
+    return regex;
+}
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    GlobMatcher.h
+
+    A set of glob patterns compiled into a single matcher.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <regex>
+
+//==============================================================================
+/**
+    Matches files and folders against a list of glob patterns, e.g. from
+    repeated --exclude options.
+
+    The patterns are compiled up front into a single regular expression for
+    names and another for paths, so a match costs one pass over the string
+    however many patterns there are.
+    Patterns without a slash are matched against an entry's name, e.g. ".git"
+    or "*.mov". Patterns with a slash are matched against its path relative to
+    the search root, e.g. "Renders/Cache". Matching ignores case.
+
+    In a pattern, "*" and "?" don't cross a slash, "**" does, and [...] is a
+    character class. Patterns that checkPattern() rejects, such as "[z-a]",
+    are ignored.
+*/
+class GlobMatcher
+{
+public:
+    explicit GlobMatcher (const juce::StringArray& patterns = {});
+
+    /** Returns true if there are no patterns to match. */
+    bool isEmpty() const noexcept                           { return nameMatcher == nullptr && pathMatcher == nullptr; }
+
+    /** Returns true if any pattern matches this entry.
+        @param name          the file or folder name
+        @param relativePath  its path from the search root, using '/' separators
+    */
+    bool matches (const juce::String& name, const juce::String& relativePath) const;
+
+    /** Fails if a pattern can't be compiled, e.g. because a character class
+        has a range that runs backwards.
+    */
+    static juce::Result checkPattern (const juce::String& pattern);
+
+    /** Converts one glob to the equivalent regular expression. */
+    static juce::String globToRegex (const juce::String& glob);
+
+private:
+    std::unique_ptr<std::regex> nameMatcher, pathMatcher;
+};
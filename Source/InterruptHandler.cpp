@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    InterruptHandler.cpp
+
+  ==============================================================================
+*/
+
+#include "InterruptHandler.h"
+#include <atomic>
+#include <csignal>
+
+#if ! JUCE_WINDOWS
+ #include <signal.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    // Lock-free, so it can be set from inside a signal handler.
+    std::atomic<int> receivedSignal { 0 };
+
+    void handleSignal (int signal)
+    {
+        receivedSignal = signal;
+    }
+}
+
+//==============================================================================
+void InterruptHandler::install()
+{
+   #if JUCE_WINDOWS
+    // The CRT puts the default handler back before calling this one.
+    std::signal (SIGINT, handleSignal);
+    std::signal (SIGTERM, handleSignal);
+    std::signal (SIGBREAK, handleSignal);
+   #else
+    struct sigaction action = {};
+    action.sa_handler = handleSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset (&action.sa_mask);
+
+    sigaction (SIGINT, &action, nullptr);
+    sigaction (SIGTERM, &action, nullptr);
+   #endif
+}
+
+bool InterruptHandler::wasInterrupted()
+{
+    return receivedSignal != 0;
+}
+
+int InterruptHandler::getExitCode()
+{
+    auto signal = receivedSignal.load();
+    return signal != 0 ? 128 + signal : 0;
+}
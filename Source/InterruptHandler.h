@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    InterruptHandler.h
+
+    Lets long-running commands stop cleanly on Ctrl-C or SIGTERM.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Catches SIGINT and SIGTERM (Ctrl-C and Ctrl-Break on Windows), and only
+    records that they arrived, so the command can poll wasInterrupted() and
+    wind down in its own time.
+
+    Only the first signal is caught. A second one ends the process at once, as
+    it would have without this.
+*/
+struct InterruptHandler
+{
+    /** Starts catching the signals. */
+    static void install();
+
+    /** Returns true once a signal has arrived. Safe to call from any thread. */
+    static bool wasInterrupted();
+
+    /** Returns the exit code the shell expects from a process stopped by the
+        signal that arrived, e.g. 130 for SIGINT, or 0 if none did.
+    */
+    static int getExitCode();
+};
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    JobDescription.cpp
+
+  ==============================================================================
+*/
+
+#include "JobDescription.h"
+
+//==============================================================================
+namespace
+{
+    void readSwitch (const juce::var& json, const char* name, bool& value)
+    {
+        if(json.hasProperty (name))
+            value = (bool) json[name];
+    }
+
+    juce::Result invalidValue (const char* name, const juce::var& value)
+    {
+        return juce::Result::fail ("\"" + value.toString() + "\" isn't a valid value for \"" + juce::String (name) + "\".");
+    }
+}
+
+//==============================================================================
+juce::Result readJobDescription (const juce::var& json, const juce::File& baseDirectory, ConversionOptions& options)
+{
+    if(! json.isObject())
+        return juce::Result::fail ("A job must be a JSON object.");
+
+    auto input = json["input"].toString();
+    if(input.isEmpty())
+        return juce::Result::fail ("A job needs an \"input\".");
+
+    options.inputFile = baseDirectory.getChildFile (input);
+
+    if(json.hasProperty ("output"))
+        options.outputFile = baseDirectory.getChildFile (json["output"].toString());
+
+    if(json.hasProperty ("sampleDirectory"))
+        options.sampleDirectory = json["sampleDirectory"].toString();
+
+    readSwitch (json, "fixLoops", options.fixLoops);
+    readSwitch (json, "bakeCrossfades", options.bakeCrossfades);
+    readSwitch (json, "dedup", options.deduplicateSamples);
+    readSwitch (json, "collectSamples", options.collectSamples);
+    readSwitch (json, "analyseLevels", options.analyseLevels);
+    readSwitch (json, "levelTrims", options.applyVolumeTrims);
+    readSwitch (json, "trimSilence", options.trimSilence);
+    readSwitch (json, "trimFiles", options.writeTrimmedFiles);
+    readSwitch (json, "physicalOrder", options.physicalOrder);
+    readSwitch (json, "preloadManifest", options.writePreloadManifest);
+
+    if(json.hasProperty ("loopSearch"))
+        options.loopSearchRadius = juce::jmax (0, (int) json["loopSearch"]);
+
+    if(json.hasProperty ("refineLoops")) {
+        auto method = json["refineLoops"].toString();
+
+        if(method == "none")                options.loopRefinement = LoopRefinement::none;
+        else if(method == "zero")           options.loopRefinement = LoopRefinement::zeroCrossing;
+        else if(method == "correlation")    options.loopRefinement = LoopRefinement::correlation;
+        else                                return invalidValue ("refineLoops", json["refineLoops"]);
+    }
+
+    if(json.hasProperty ("consolidate")) {
+        auto scope = json["consolidate"].toString();
+
+        if(scope == "none")                 options.consolidation = ConsolidationScope::none;
+        else if(scope == "preset")          options.consolidation = ConsolidationScope::preset;
+        else if(scope == "group")           options.consolidation = ConsolidationScope::group;
+        else                                return invalidValue ("consolidate", json["consolidate"]);
+    }
+
+    if(json.hasProperty ("transcode")) {
+        auto format = json["transcode"].toString();
+
+        if(format == "none")
+            options.transcodeTarget = {};
+        else if(! TranscodeTarget::fromName (format, options.transcodeTarget))
+            return invalidValue ("transcode", json["transcode"]);
+    }
+
+    if(options.collectSamples && options.sampleDirectory.isEmpty())
+        return juce::Result::fail ("\"collectSamples\" needs a \"sampleDirectory\" to collect the samples into.");
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+    JobDescription.h
+
+    Reads conversion jobs described in JSON.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConversionJob.h"
+
+//==============================================================================
+/**
+    Fills in ConversionOptions from a JSON object such as
+
+        { "input": "Piano.exs", "output": "Piano.dspreset", "sampleDirectory": "Samples",
+          "dedup": true, "transcode": "flac24" }
+
+    "input" is required. Relative paths are taken from baseDirectory. Any other
+    conversion option can be set for the job using the name of its command
+    line option in camelCase: the switches take true or false, "loopSearch"
+    takes a number, and "refineLoops", "consolidate" and "transcode" take the
+    same values as on the command line, or "none". Anything the job doesn't
+    mention keeps the value already in options.
+
+    Fails if the JSON isn't an object, has no input, or gives an option a value
+    it can't take.
+*/
+juce::Result readJobDescription (const juce::var& json, const juce::File& baseDirectory, ConversionOptions& options);
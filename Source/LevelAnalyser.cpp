@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    LevelAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "LevelAnalyser.h"
+#include "AudioFiles.h"
+#include "ParallelFor.h"
+#include "VectorOps.h"
+#include <set>
+#include <tuple>
+
+//==============================================================================
+namespace
+{
+    constexpr int measureBlockSize = 65536;
+
+    /** How much quieter a higher velocity layer can be before it's reported. */
+    constexpr float layerOrderToleranceDecibels = 1.0f;
+
+    constexpr float maxTrimDecibels = 12.0f;
+
+    struct Zone
+    {
+        juce::XmlElement* sample = nullptr;
+        juce::File file;
+        juce::Range<juce::int64> range;
+        int loNote = 0, hiNote = 127, loVel = 1, hiVel = 127;
+        bool isRelease = false;
+        SampleLevels levels;
+        float volumeDecibels = 0, trimDecibels = 0;
+
+        /** The zone's RMS level once its own volume has been applied. */
+        float getPlayedDecibels() const     { return levels.rmsDecibels + volumeDecibels; }
+    };
+
+    /** Reads a volume attribute, which Decent Sampler takes either in dB ("-3dB")
+        or as a linear gain.
+    */
+    double getVolumeDecibels (const juce::XmlElement& sample)
+    {
+        auto volume = sample.getStringAttribute ("volume").trim();
+        if(volume.isEmpty())
+            return 0;
+
+        if(volume.endsWithIgnoreCase ("dB"))
+            return volume.dropLastCharacters (2).getDoubleValue();
+
+        return juce::Decibels::gainToDecibels (volume.getDoubleValue());
+    }
+
+    juce::String describeZone (const Zone& zone)
+    {
+        return "\"" + zone.file.getFileName() + "\" (velocity " + juce::String (zone.loVel) + "-" + juce::String (zone.hiVel) + ")";
+    }
+}
+
+//==============================================================================
+LevelAnalyser::LevelAnalyser (ProfileStats& s)
+    : stats (s)
+{
+}
+
+SampleLevels LevelAnalyser::getLevels (const juce::File& file, juce::Range<juce::int64> range)
+{
+    auto key = file.getFullPathName() + "\t" + juce::String (range.getStart()) + "\t" + juce::String (range.getEnd());
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto existing = levels.find (key);
+        if(existing != levels.end())
+            return existing->second;
+    }
+
+    auto measured = measure (file, range);
+
+    const juce::ScopedLock sl (lock);
+    levels[key] = measured;
+    return measured;
+}
+
+void LevelAnalyser::startNewRun()
+{
+    const juce::ScopedLock sl (lock);
+    levels.clear();
+}
+
+juce::Range<juce::int64> LevelAnalyser::getZoneRange (const juce::XmlElement& sample)
+{
+    auto start = (juce::int64) sample.getDoubleAttribute ("start", 0);
+    auto end = sample.hasAttribute ("end") ? (juce::int64) sample.getDoubleAttribute ("end") : getWholeFile().getEnd();
+    return { juce::jmax ((juce::int64) 0, start), juce::jmax ((juce::int64) 0, end) };
+}
+
+SampleLevels LevelAnalyser::measure (const juce::File& file, juce::Range<juce::int64> range) const
+{
+    auto reader = createSampleReader (file);
+    if(reader == nullptr || reader->numChannels == 0)
+        return {};
+
+    // Only the frames the zone plays, so silence or other takes before its
+    // start or after its end don't skew its level.
+    range = range.getIntersectionWith ({ 0, reader->lengthInSamples });
+    if(range.isEmpty())
+        return {};
+
+    const auto length = range.getLength();
+    const auto numChannels = (int) reader->numChannels;
+    juce::AudioBuffer<float> buffer (numChannels, (int) juce::jmin ((juce::int64) measureBlockSize, length));
+
+    float peak = 0;
+    double sumOfSquares = 0;
+
+    for(juce::int64 position = range.getStart(); position < range.getEnd(); position += measureBlockSize) {
+        auto numSamples = (int) juce::jmin ((juce::int64) measureBlockSize, range.getEnd() - position);
+        reader->read (&buffer, 0, numSamples, position, true, true);
+
+        for(int channel = 0; channel < numChannels; ++channel) {
+            auto* data = buffer.getReadPointer (channel);
+            auto minAndMax = juce::FloatVectorOperations::findMinAndMax (data, numSamples);
+            peak = juce::jmax (peak, -minAndMax.getStart(), minAndMax.getEnd());
+            sumOfSquares += VectorOps::sumOfSquares (data, numSamples);
+        }
+    }
+
+    stats.add ("levels.samplesMeasured");
+    stats.add ("levels.framesRead", length);
+
+    SampleLevels result;
+    result.isValid = true;
+    result.peakDecibels = juce::Decibels::gainToDecibels (peak);
+    result.rmsDecibels = juce::Decibels::gainToDecibels ((float) std::sqrt (sumOfSquares / (double) (length * numChannels)));
+    return result;
+}
+
+//==============================================================================
+juce::Result LevelAnalyser::analyse (PresetDocument& preset, juce::ThreadPool& pool, bool applyVolumeTrims,
+                                     const juce::File& reportFile, juce::StringArray& warnings)
+{
+    std::set<juce::XmlElement*> releaseSamples;
+    for(auto* group : preset.getGroups())
+        if(group->getStringAttribute ("trigger").equalsIgnoreCase ("release"))
+            for(auto* sample : PresetDocument::getSamplesIn (*group))
+                releaseSamples.insert (sample);
+
+    std::vector<Zone> zones;
+
+    for(auto* sample : preset.getSamples()) {
+        Zone zone;
+        zone.sample = sample;
+        zone.file = preset.getSampleFile (*sample);
+        zone.range = getZoneRange (*sample);
+        zone.loNote = sample->getIntAttribute ("loNote", 0);
+        zone.hiNote = sample->getIntAttribute ("hiNote", 127);
+        zone.loVel = sample->getIntAttribute ("loVel", 1);
+        zone.hiVel = sample->getIntAttribute ("hiVel", 127);
+        zone.isRelease = releaseSamples.count (sample) > 0 || sample->getStringAttribute ("trigger").equalsIgnoreCase ("release");
+        zone.volumeDecibels = (float) getVolumeDecibels (*sample);
+        zones.push_back (zone);
+    }
+
+    {
+        // Zones that play the same part of the same file are only measured once.
+        std::vector<const Zone*> toMeasure;
+        std::set<std::tuple<juce::String, juce::int64, juce::int64>> queued;
+
+        for(auto& zone : zones)
+            if(queued.insert ({ zone.file.getFullPathName(), zone.range.getStart(), zone.range.getEnd() }).second)
+                toMeasure.push_back (&zone);
+
+        ProfileStats::ScopedStage stage (stats, "levels.measure");
+        parallelFor (pool, (int) toMeasure.size(), [&] (int i) { getLevels (toMeasure[(size_t) i]->file, toMeasure[(size_t) i]->range); });
+    }
+
+    for(auto& zone : zones)
+        zone.levels = getLevels (zone.file, zone.range);
+
+    // Within every note, each velocity layer should be at least as loud as the one below it.
+    std::vector<std::vector<const Zone*>> zonesByNote (128);
+    for(auto& zone : zones)
+        if(zone.levels.isValid && ! zone.isRelease)
+            for(int note = juce::jmax (0, zone.loNote); note <= juce::jmin (127, zone.hiNote); ++note)
+                zonesByNote[(size_t) note].push_back (&zone);
+
+    std::set<std::pair<const Zone*, const Zone*>> reported;
+
+    for(int note = 0; note < 128; ++note) {
+        auto& layers = zonesByNote[(size_t) note];
+        std::sort (layers.begin(), layers.end(), [] (const Zone* a, const Zone* b)
+        {
+            return a->loVel != b->loVel ? a->loVel < b->loVel : a->hiVel < b->hiVel;
+        });
+
+        for(size_t i = 1; i < layers.size(); ++i) {
+            auto* lower = layers[i - 1];
+            auto* upper = layers[i];
+            auto difference = lower->getPlayedDecibels() - upper->getPlayedDecibels();
+
+            // Overlapping velocity ranges are round robins or crossfaded layers, not a step up.
+            if(lower->hiVel >= upper->loVel || difference <= layerOrderToleranceDecibels
+                || ! reported.insert ({ lower, upper }).second)
+                continue;
+
+            stats.add ("levels.layersOutOfOrder");
+            warnings.add (describeZone (*upper) + " is " + juce::String (difference, 1) + " dB quieter than "
+                            + describeZone (*lower) + " on note " + juce::String (note) + ".");
+        }
+    }
+
+    // Trims bring each zone to the average RMS of its velocity layer.
+    std::map<std::tuple<int, int, bool>, std::pair<double, int>> layerLevels;
+    for(auto& zone : zones) {
+        if(zone.levels.isValid) {
+            auto& layer = layerLevels[{ zone.loVel, zone.hiVel, zone.isRelease }];
+            layer.first += zone.getPlayedDecibels();
+            ++layer.second;
+        }
+    }
+
+    for(auto& zone : zones) {
+        if(! zone.levels.isValid)
+            continue;
+
+        auto& layer = layerLevels[{ zone.loVel, zone.hiVel, zone.isRelease }];
+        auto layerAverage = (float) (layer.first / layer.second);
+        zone.trimDecibels = juce::jlimit (-maxTrimDecibels, maxTrimDecibels, layerAverage - zone.getPlayedDecibels());
+
+        if(applyVolumeTrims && std::abs (zone.trimDecibels) >= 0.05f) {
+            zone.sample->setAttribute ("volume", juce::String (zone.volumeDecibels + zone.trimDecibels, 2) + "dB");
+            stats.add ("levels.zonesTrimmed");
+        }
+    }
+
+    if(reportFile == juce::File())
+        return juce::Result::ok();
+
+    juce::MemoryOutputStream out;
+    out << "sample\tloNote\thiNote\tloVel\thiVel\tpeak dBFS\tRMS dBFS\ttrim dB\n";
+
+    for(auto& zone : zones) {
+        out << zone.file.getFullPathName() << "\t" << zone.loNote << "\t" << zone.hiNote << "\t"
+            << zone.loVel << "\t" << zone.hiVel << "\t";
+
+        if(zone.levels.isValid)
+            out << juce::String (zone.levels.peakDecibels, 2) << "\t" << juce::String (zone.levels.rmsDecibels, 2) << "\t"
+                << juce::String (zone.trimDecibels, 2) << "\n";
+        else
+            out << "-\t-\t-\n";
+    }
+
+    if(! reportFile.replaceWithData (out.getData(), out.getDataSize()))
+        return juce::Result::fail ("Couldn't write \"" + reportFile.getFullPathName() + "\".");
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LevelAnalyser.h
+
+    Measures the peak and RMS level of every zone, for QA reports and
+    volume trims.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include <limits>
+#include <map>
+
+//==============================================================================
+/** The levels of a sample file, or of the part of it a zone plays, in dBFS. */
+struct SampleLevels
+{
+    bool isValid = false;
+    float peakDecibels = -100.0f;
+    float rmsDecibels = -100.0f;
+};
+
+//==============================================================================
+/**
+    Measures each zone's peak and RMS level over the frames it plays, from its
+    start to its end attribute, reading them once through a fixed-size buffer,
+    with zones measured in parallel. The reductions use
+    FloatVectorOperations::findMinAndMax and VectorOps::sumOfSquares.
+
+    analyse() writes a tab-separated report with one line per zone, and warns
+    about velocity layers that are out of order: a zone that is quieter than
+    a zone covering the same note at a lower velocity, once each zone's own
+    volume is taken into account. Release-triggered zones are left out of that
+    check.
+
+    It can also set each zone's volume so that every zone in a velocity layer
+    has the layer's average RMS level. This evens out notes that were recorded
+    hotter or quieter than their neighbours while keeping the difference
+    between layers. Trims are limited to +/-12 dB and are added to any volume
+    the zone already has.
+
+    Levels are remembered for the rest of the run, for each file and range.
+    All methods are thread-safe.
+*/
+class LevelAnalyser
+{
+public:
+    explicit LevelAnalyser (ProfileStats& stats);
+
+    /** Measures every zone in the preset, writes the report to reportFile (if it
+        isn't File()), and adds a warning for each out-of-order velocity layer.
+    */
+    juce::Result analyse (PresetDocument& preset, juce::ThreadPool& pool, bool applyVolumeTrims,
+                          const juce::File& reportFile, juce::StringArray& warnings);
+
+    /** Returns the levels of the frames in a sample file from range's start up
+        to its end, measuring them if they haven't been yet. The range is
+        clipped to the file's length.
+    */
+    SampleLevels getLevels (const juce::File& file, juce::Range<juce::int64> range = getWholeFile());
+
+    /** The range of frames a zone plays, from its start and end attributes. */
+    static juce::Range<juce::int64> getZoneRange (const juce::XmlElement& sample);
+
+    /** A range covering every frame of any file. */
+    static juce::Range<juce::int64> getWholeFile()      { return { 0, std::numeric_limits<juce::int64>::max() }; }
+
+    /** Forgets the levels measured so far. */
+    void startNewRun();
+
+private:
+    SampleLevels measure (const juce::File& file, juce::Range<juce::int64> range) const;
+
+    ProfileStats& stats;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, SampleLevels> levels;
+
+    JUCE_DECLARE_NON_COPYABLE (LevelAnalyser)
+};
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    LoopPoints.cpp
+
+  ==============================================================================
+*/
+
+#include "LoopPoints.h"
+
+//==============================================================================
+static juce::String describeZone (const PresetDocument& preset, const juce::XmlElement& sample)
+{
+    return "\"" + preset.getSampleFile (sample).getFileName() + "\" (notes "
+            + sample.getStringAttribute ("loNote", "?") + "-" + sample.getStringAttribute ("hiNote", "?") + ")";
+}
+
+//==============================================================================
+void convertLoopCrossfadePoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                                 juce::StringArray& warnings)
+{
+    for(auto* sample : preset.getSamples()) {
+        if(! sample->hasAttribute ("loopCrossfade"))
+            continue;
+
+        auto header = headers.getHeader (preset.getSampleFile (*sample));
+        if(! header.isValid) {
+            // Left as it is, the milliseconds would be read as a number of samples.
+            sample->removeAttribute ("loopCrossfade");
+            stats.add ("loops.crossfadesWithoutSampleRate");
+            warnings.add (describeZone (preset, *sample) + ": couldn't read the sample's rate, so its loop crossfade was dropped.");
+            continue;
+        }
+
+        auto milliseconds = sample->getDoubleAttribute ("loopCrossfade");
+        sample->setAttribute ("loopCrossfade", juce::roundToInt (milliseconds * header.sampleRate / 1000.0));
+    }
+}
+
+//==============================================================================
+int validateLoopPoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                        bool clampToSampleLength, juce::StringArray& warnings)
+{
+    int numZonesWithProblems = 0;
+
+    for(auto* sample : preset.getSamples()) {
+        if(! sample->getBoolAttribute ("loopEnabled", true)
+            || (! sample->hasAttribute ("loopStart") && ! sample->hasAttribute ("loopEnd")))
+            continue;
+
+        auto header = headers.getHeader (preset.getSampleFile (*sample));
+        if(! header.isValid || header.lengthInSamples <= 0)
+            continue;
+
+        const auto lastSample = header.lengthInSamples - 1;
+        const auto loopStart = (juce::int64) sample->getDoubleAttribute ("loopStart", 0);
+        const auto loopEnd = (juce::int64) sample->getDoubleAttribute ("loopEnd", (double) lastSample);
+        const auto crossfade = (juce::int64) sample->getDoubleAttribute ("loopCrossfade", 0);
+
+        auto fixedStart = juce::jlimit ((juce::int64) 0, lastSample, loopStart);
+        auto fixedEnd = juce::jlimit ((juce::int64) 0, lastSample, loopEnd);
+        auto fixedCrossfade = juce::jlimit ((juce::int64) 0, juce::jmax ((juce::int64) 0, fixedEnd - fixedStart), crossfade);
+
+        juce::StringArray problems;
+        if(loopStart != fixedStart)
+            problems.add ("loop start " + juce::String (loopStart) + " is outside the sample");
+        if(loopEnd != fixedEnd)
+            problems.add ("loop end " + juce::String (loopEnd) + " is beyond the sample's last frame (" + juce::String (lastSample) + ")");
+        if(fixedEnd <= fixedStart)
+            problems.add ("the loop is empty");
+        else if(crossfade != fixedCrossfade)
+            problems.add ("the crossfade (" + juce::String (crossfade) + ") is longer than the loop (" + juce::String (fixedEnd - fixedStart) + ")");
+
+        if(problems.isEmpty())
+            continue;
+
+        ++numZonesWithProblems;
+        stats.add ("loops.invalid");
+        warnings.add (describeZone (preset, *sample) + ": " + problems.joinIntoString ("; ") + ".");
+
+        if(! clampToSampleLength)
+            continue;
+
+        stats.add ("loops.clamped");
+
+        if(fixedEnd <= fixedStart) {
+            sample->setAttribute ("loopEnabled", "false");
+            sample->removeAttribute ("loopCrossfade");
+            continue;
+        }
+
+        if(sample->hasAttribute ("loopStart"))
+            sample->setAttribute ("loopStart", juce::String (fixedStart));
+        sample->setAttribute ("loopEnd", juce::String (fixedEnd));
+        if(sample->hasAttribute ("loopCrossfade"))
+            sample->setAttribute ("loopCrossfade", juce::String (fixedCrossfade));
+    }
+
+    return numZonesWithProblems;
+}
+
+//==============================================================================
+bool getZoneLoop (const juce::XmlElement& sample, const SampleHeader& header, juce::int64& loopStart, juce::int64& loopEnd)
+{
+    if(! sample.hasAttribute ("loopStart") && ! sample.hasAttribute ("loopEnd")
+        && ! sample.getBoolAttribute ("loopEnabled", false) && header.loopStart < 0)
+        return false;
+
+    loopStart = (juce::int64) sample.getDoubleAttribute ("loopStart", (double) juce::jmax ((juce::int64) 0, header.loopStart));
+    loopEnd = (juce::int64) sample.getDoubleAttribute ("loopEnd", (double) (header.loopEnd >= 0 ? header.loopEnd : header.lengthInSamples - 1));
+    return true;
+}
+
+void writeEmbeddedLoopAttributes (juce::XmlElement& sample, const SampleHeader& header, juce::int64 offset)
+{
+    juce::int64 loopStart, loopEnd;
+    if(getZoneLoop (sample, header, loopStart, loopEnd)) {
+        sample.setAttribute ("loopStart", juce::String (offset + loopStart));
+        sample.setAttribute ("loopEnd", juce::String (offset + loopEnd));
+    }
+
+    if(! sample.hasAttribute ("rootNote") && header.rootNote >= 0)
+        sample.setAttribute ("rootNote", header.rootNote);
+}
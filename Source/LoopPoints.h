@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    LoopPoints.h
+
+    Stages that work on the loop attributes of the preset's <sample> elements.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+
+//==============================================================================
+/** Converts each zone's loopCrossfade from the milliseconds stored in the EXS
+    file to the samples Decent Sampler expects, using the probed sample rate.
+    Zones whose sample couldn't be probed lose their crossfade, and a warning
+    is added for each.
+
+    This replaces DSPresetConverter::convertEXSLoopCrossfadePoints(), which opens
+    every sample with an AudioFormatReader just to learn its sample rate.
+*/
+void convertLoopCrossfadePoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                                 juce::StringArray& warnings);
+
+/** Checks every zone's loopStart, loopEnd and loopCrossfade against the probed
+    length of its sample, adding a warning for each zone that is out of range.
+
+    If clampToSampleLength is true, bad loops are also fixed: loop points are
+    clamped to the sample, crossfades are shortened to fit the loop, and loops
+    that end up empty are disabled.
+
+    This only uses cached header data, so it adds next to nothing to a run.
+    Returns the number of zones with problems.
+*/
+int validateLoopPoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                        bool clampToSampleLength, juce::StringArray& warnings);
+
+/** Finds the loop a zone plays, from its attributes or else from the sample's
+    own chunks. Returns false if the zone has no loop.
+*/
+bool getZoneLoop (const juce::XmlElement& sample, const SampleHeader& header, juce::int64& loopStart, juce::int64& loopEnd);
+
+/** Writes a zone's loop and root note as attributes, taking any that the zone
+    doesn't already have from the sample's own chunks, and moves its loop
+    points by offset.
+
+    Stages that replace a zone's sample file use this, since the new file won't
+    carry the original's smpl or INST chunks.
+*/
+void writeEmbeddedLoopAttributes (juce::XmlElement& sample, const SampleHeader& header, juce::int64 offset = 0);
@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    LoopRefinement.cpp
+
+  ==============================================================================
+*/
+
+#include "LoopRefinement.h"
+#include "AudioFiles.h"
+#include "LoopPoints.h"
+#include "ParallelFor.h"
+#include "VectorOps.h"
+#include <map>
+
+//==============================================================================
+namespace
+{
+    /** How many frames of lead-in the correlation method compares. */
+    constexpr int matchLength = 256;
+
+    /** Reads a run of frames mixed down to mono. Frames outside the file read as silence. */
+    void readMono (juce::AudioFormatReader& reader, juce::int64 start, int numFrames,
+                   juce::AudioBuffer<float>& scratch, std::vector<float>& mono)
+    {
+        scratch.setSize ((int) reader.numChannels, numFrames, false, false, true);
+        reader.read (&scratch, 0, numFrames, start, true, true);
+
+        mono.resize ((size_t) numFrames);
+        juce::FloatVectorOperations::copy (mono.data(), scratch.getReadPointer (0), numFrames);
+
+        for(int channel = 1; channel < scratch.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::add (mono.data(), scratch.getReadPointer (channel), numFrames);
+    }
+
+    /** Returns the index i closest to centre where x[i - 1] < 0 <= x[i], or -1. */
+    int findNearestRisingCrossing (const std::vector<float>& x, int centre, std::vector<float>& products)
+    {
+        // Neighbouring frames multiply to <= 0 wherever the signal touches or
+        // crosses zero, which rules out almost every frame in one pass.
+        auto numPairs = (int) x.size() - 1;
+        products.resize ((size_t) juce::jmax (0, numPairs));
+        juce::FloatVectorOperations::multiply (products.data(), x.data(), x.data() + 1, numPairs);
+
+        int nearest = -1;
+
+        for(int i = 0; i < numPairs; ++i) {
+            if(products[(size_t) i] > 0 || ! (x[(size_t) i] < 0 && x[(size_t) i + 1] >= 0))
+                continue;
+
+            if(nearest < 0 || std::abs (i + 1 - centre) < std::abs (nearest - centre))
+                nearest = i + 1;
+        }
+
+        return nearest;
+    }
+
+    struct Loop
+    {
+        juce::int64 start, end;
+    };
+
+    Loop refineZeroCrossing (juce::AudioFormatReader& reader, Loop loop, int radius,
+                             juce::AudioBuffer<float>& scratch, std::vector<float>& mono, std::vector<float>& products)
+    {
+        const auto numFrames = 2 * radius + 2;
+
+        // The start should be the first frame of a rising crossing...
+        auto windowStart = loop.start - radius - 1;
+        readMono (reader, windowStart, numFrames, scratch, mono);
+        auto crossing = findNearestRisingCrossing (mono, radius + 1, products);
+        if(crossing >= 0)
+            loop.start = windowStart + crossing;
+
+        // ...and the end the frame just before one, so the jump back lands mid-crossing.
+        windowStart = loop.end - radius;
+        readMono (reader, windowStart, numFrames, scratch, mono);
+        crossing = findNearestRisingCrossing (mono, radius + 1, products);
+        if(crossing >= 0)
+            loop.end = windowStart + crossing - 1;
+
+        return loop;
+    }
+
+    Loop refineCorrelation (juce::AudioFormatReader& reader, Loop loop, int radius,
+                            juce::AudioBuffer<float>& scratch, std::vector<float>& mono, std::vector<float>& candidates)
+    {
+        auto length = (int) juce::jmin ((juce::int64) matchLength, loop.start);
+        if(length < 16)
+            return loop;
+
+        // What normally plays just before the loop start...
+        readMono (reader, loop.start - length, length, scratch, mono);
+        auto leadIn = mono;
+
+        // ...against what plays just before the jump, for every candidate end.
+        auto firstCandidate = loop.end - radius;
+        readMono (reader, firstCandidate - length + 1, 2 * radius + length, scratch, candidates);
+
+        auto bestEnd = loop.end;
+        auto bestDifference = std::numeric_limits<float>::max();
+
+        for(int i = 0; i <= 2 * radius; ++i) {
+            auto difference = VectorOps::sumOfSquaredDifferences (leadIn.data(), candidates.data() + i, length);
+            auto end = firstCandidate + i;
+
+            if(difference < bestDifference
+                || (difference == bestDifference && std::abs (end - loop.end) < std::abs (bestEnd - loop.end))) {
+                bestDifference = difference;
+                bestEnd = end;
+            }
+        }
+
+        loop.end = bestEnd;
+        return loop;
+    }
+}
+
+//==============================================================================
+void refineLoopPoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                       juce::ThreadPool& pool, LoopRefinement method, int searchRadius)
+{
+    if(method == LoopRefinement::none || searchRadius <= 0)
+        return;
+
+    // Zones are grouped by file, so each file is opened once and each zone is
+    // only ever touched by one thread.
+    std::map<juce::String, juce::Array<juce::XmlElement*>> zonesByFile;
+    juce::Array<juce::File> files;
+
+    for(auto* sample : preset.getSamples()) {
+        if(! sample->getBoolAttribute ("loopEnabled", true))
+            continue;
+
+        auto file = preset.getSampleFile (*sample);
+        auto& zones = zonesByFile[file.getFullPathName()];
+        if(zones.isEmpty())
+            files.add (file);
+
+        zones.add (sample);
+    }
+
+    parallelFor (pool, files.size(), [&] (int i)
+    {
+        auto& file = files.getReference (i);
+        auto header = headers.getHeader (file);
+        if(! header.isValid || header.lengthInSamples < 2)
+            return;
+
+        auto reader = createSampleReader (file);
+        if(reader == nullptr)
+            return;
+
+        juce::AudioBuffer<float> scratch;
+        std::vector<float> mono, work;
+
+        for(auto* sample : zonesByFile[file.getFullPathName()]) {
+            Loop original;
+            if(! getZoneLoop (*sample, header, original.start, original.end))
+                continue;
+
+            auto refined = method == LoopRefinement::zeroCrossing
+                            ? refineZeroCrossing (*reader, original, searchRadius, scratch, mono, work)
+                            : refineCorrelation (*reader, original, searchRadius, scratch, mono, work);
+
+            const auto lastFrame = header.lengthInSamples - 1;
+            const auto crossfade = (juce::int64) sample->getDoubleAttribute ("loopCrossfade", 0);
+            refined.start = juce::jlimit ((juce::int64) 0, lastFrame, refined.start);
+            refined.end = juce::jlimit ((juce::int64) 0, lastFrame, refined.end);
+
+            if(refined.end - refined.start <= crossfade) {
+                stats.add ("loops.refinementsRejected");
+                continue;
+            }
+
+            if(refined.start == original.start && refined.end == original.end)
+                continue;
+
+            sample->setAttribute ("loopStart", juce::String (refined.start));
+            sample->setAttribute ("loopEnd", juce::String (refined.end));
+            stats.add ("loops.refined");
+        }
+    });
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    LoopRefinement.h
+
+    Moves loop points to where the audio joins up without a click.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+
+//==============================================================================
+/** How refineLoopPoints() picks new loop points. */
+enum class LoopRefinement
+{
+    none,
+
+    /** Moves the loop start to the nearest rising zero crossing, and the loop
+        end to just before the nearest one, so the waveform is continuous
+        across the jump.
+    */
+    zeroCrossing,
+
+    /** Leaves the loop start alone and moves the loop end to where the audio
+        leading up to it best matches the audio leading up to the loop start.
+    */
+    correlation
+};
+
+/**
+    Adjusts the loop points of every looping zone by at most searchRadius
+    frames.
+
+    Only the frames around each loop point are decoded, with channels mixed to
+    mono, and the searches run on vectorised kernels, so this is cheap enough
+    for libraries with hundreds of thousands of zones. Samples are processed in
+    parallel on the pool, with each file opened once however many zones use it.
+*/
+void refineLoopPoints (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                       juce::ThreadPool& pool, LoopRefinement method, int searchRadius);
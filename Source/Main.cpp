@@ -7,77 +7,543 @@
 */
 
 #include <JuceHeader.h>
-#include "DSPresetConverter/Source/DSEXS24.h"
-#include "DSPresetConverter/Source/DSPresetConverter.h"
+#include "BatchRunner.h"
+#include "ConversionJob.h"
+#include "ConversionServer.h"
+#include "InterruptHandler.h"
+#include "StandardStreams.h"
+#include "WatchFolder.h"
 #include <tclap/CmdLine.h>
+#include <tclap/ValuesConstraint.h>
+
+//==============================================================================
+/** EXS2DS warm <manifest>... : pulls the samples listed in preload manifests into the page cache. */
+static int runWarmCommand (int argc, char* argv[])
+{
+    try {
+        
+        TCLAP::CmdLine cmd("Reads the samples listed in preload manifests into the OS page cache, so that the first load of their presets isn't held up by the disk.", ' ', "1.1.0");
+        TCLAP::UnlabeledMultiArg<std::string> manifestsArg( "manifests", "The .preload files written by --preload-manifest.", true, "manifest" );
+        cmd.add( manifestsArg );
+        
+        TCLAP::ValueArg<int> jobsArg( "j", "jobs", "The number of files to read at once. Defaults to one per CPU.", false, 0, "count" );
+        cmd.add( jobsArg );
+        
+        TCLAP::SwitchArg profileArg( "", "profile", "Print timings and counters to stderr when done.", false );
+        cmd.add( profileArg );
+        
+        cmd.parse( argc, argv );
+        
+        PreloadManifest manifest;
+        for(auto& path : manifestsArg.getValue()) {
+            PreloadManifest loaded;
+            auto result = PreloadManifest::load(juce::File::getCurrentWorkingDirectory().getChildFile(path), loaded);
+            if(result.failed()) {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return 2;
+            }
+            
+            manifest.entries.insert(manifest.entries.end(), loaded.entries.begin(), loaded.entries.end());
+        }
+        
+        ProfileStats stats;
+        juce::ThreadPool pool (jobsArg.getValue() > 0 ? jobsArg.getValue() : juce::SystemStats::getNumCpus());
+        
+        int numFailed;
+        {
+            ProfileStats::ScopedStage stage (stats, "warm");
+            numFailed = manifest.warm(pool, stats);
+        }
+        
+        std::cerr << "Warmed " << stats.get("warm.files") << " files (" << juce::File::descriptionOfSizeInBytes(stats.get("warm.bytes")) << ")" << std::endl;
+        if(numFailed > 0)
+            std::cerr << "Warning: " << numFailed << " files couldn't be opened." << std::endl;
+        
+        if(profileArg.getValue())
+            stats.print(std::cerr);
+        
+        return numFailed > 0 ? 1 : 0;
+        
+    } catch (TCLAP::ArgException &e)
+    { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
+    
+    return 2;
+}
+
+//==============================================================================
+/** The command line options shared by every command that converts presets. */
+struct ConversionArgs
+{
+    explicit ConversionArgs (TCLAP::CmdLine& cmd)
+    {
+        cmd.add( lowMetadataArg );
+        cmd.add( ignoreSymlinksArg );
+        cmd.add( excludeArg );
+        cmd.add( fixLoopsArg );
+        cmd.add( refineLoopsArg );
+        cmd.add( loopSearchArg );
+        cmd.add( bakeCrossfadesArg );
+        cmd.add( dedupArg );
+        cmd.add( collectSamplesArg );
+        cmd.add( analyseLevelsArg );
+        cmd.add( levelTrimsArg );
+        cmd.add( consolidateArg );
+        cmd.add( trimSilenceArg );
+        cmd.add( trimFilesArg );
+        cmd.add( transcodeArg );
+        cmd.add( transcodeMemoryArg );
+        cmd.add( physicalOrderArg );
+        cmd.add( preloadManifestArg );
+        cmd.add( ioPerDeviceArg );
+        cmd.add( metadataPerDeviceArg );
+        cmd.add( maxOpenFilesArg );
+        cmd.add( jobsArg );
+        cmd.add( headerCacheArg );
+        cmd.add( noHeaderCacheArg );
+        cmd.add( profileArg );
+    }
+    
+    /** Everything but the input and output files. */
+    ConversionOptions getOptions (const std::string& sampleDirectory)
+    {
+        ConversionOptions options;
+        options.sampleDirectory = sampleDirectory;
+        options.fixLoops = fixLoopsArg.getValue();
+        options.deduplicateSamples = dedupArg.getValue();
+        if(refineLoopsArg.isSet())
+            options.loopRefinement = refineLoopsArg.getValue() == "correlation" ? LoopRefinement::correlation : LoopRefinement::zeroCrossing;
+        options.loopSearchRadius = loopSearchArg.getValue();
+        options.bakeCrossfades = bakeCrossfadesArg.getValue();
+        options.collectSamples = collectSamplesArg.getValue();
+        options.physicalOrder = physicalOrderArg.getValue();
+        options.writePreloadManifest = preloadManifestArg.getValue();
+        if(consolidateArg.isSet())
+            options.consolidation = consolidateArg.getValue() == "group" ? ConsolidationScope::group : ConsolidationScope::preset;
+        options.trimSilence = trimSilenceArg.isSet();
+        options.writeTrimmedFiles = trimFilesArg.getValue();
+        if(transcodeArg.isSet())
+            TranscodeTarget::fromName(transcodeArg.getValue(), options.transcodeTarget);
+        options.analyseLevels = analyseLevelsArg.getValue();
+        options.applyVolumeTrims = levelTrimsArg.getValue();
+        return options;
+    }
+    
+    /** Throws a TCLAP::ArgException if an option's value can't be used. */
+    ConversionContext::Options getContextOptions()
+    {
+        ConversionContext::Options contextOptions;
+        contextOptions.index.lowMetadata = lowMetadataArg.getValue();
+        contextOptions.index.followSymlinks = ! ignoreSymlinksArg.getValue();
+        for(auto& pattern : excludeArg.getValue()) {
+            auto checked = GlobMatcher::checkPattern(pattern);
+            if(checked.failed())
+                throw TCLAP::CmdLineParseException(checked.getErrorMessage().toStdString(), excludeArg.longID());
+            
+            contextOptions.index.excludePatterns.add(pattern);
+        }
+        
+        contextOptions.numThreads = jobsArg.getValue();
+        contextOptions.maxOperationsPerDevice = ioPerDeviceArg.getValue();
+        contextOptions.maxMetadataOperationsPerDevice = metadataPerDeviceArg.getValue();
+        contextOptions.maxOpenFiles = maxOpenFilesArg.getValue();
+        contextOptions.silenceThresholdDecibels = trimSilenceArg.getValue();
+        contextOptions.transcodeMemoryBudget = (juce::int64) juce::jmax(1, transcodeMemoryArg.getValue()) * 1024 * 1024;
+        if(! noHeaderCacheArg.getValue()) {
+            contextOptions.headerCacheFile = headerCacheArg.isSet() ? juce::File::getCurrentWorkingDirectory().getChildFile(headerCacheArg.getValue())
+                                                                    : SampleHeaderCache::getDefaultCacheFile();
+        }
+        return contextOptions;
+    }
+    
+    /** Prints the totals asked for on the command line once the conversions are done. */
+    void printSummary (ConversionContext& context)
+    {
+        if(lowMetadataArg.getValue())
+            std::cerr << "Metadata operations: " << context.getMetadataOperationCount() << std::endl;
+        
+        if(dedupArg.getValue())
+            std::cerr << "Duplicate samples: " << juce::File::descriptionOfSizeInBytes(context.deduplicator.getBytesSaved()) << " saved" << std::endl;
+        
+        if(profileArg.getValue())
+            context.stats.print(std::cerr);
+    }
+    
+    static std::vector<std::string> getTranscodeFormats()
+    {
+        std::vector<std::string> formats;
+        for(auto& name : TranscodeTarget::getNames())
+            formats.push_back(name.toStdString());
+        return formats;
+    }
+    
+    TCLAP::SwitchArg lowMetadataArg { "", "low-metadata", "Find samples by listing each directory at most once, rather than checking each file. Use this when the EXS file or its samples are on a network filesystem.", false };
+    TCLAP::SwitchArg ignoreSymlinksArg { "", "ignore-symlinks", "Don't follow symlinked files or folders when hunting for samples.", false };
+    TCLAP::MultiArg<std::string> excludeArg { "", "exclude", "A glob pattern for files or folders to skip when hunting for samples, e.g. \".git\", \"__MACOSX\" or \"Renders/*\". Can be given more than once.", false, "glob" };
+    TCLAP::SwitchArg fixLoopsArg { "", "fix-loops", "Clamp loop points and crossfades that don't fit their sample, rather than only warning about them.", false };
+    
+    std::vector<std::string> refinementMethods { "zero", "correlation" };
+    TCLAP::ValuesConstraint<std::string> refinementConstraint { refinementMethods };
+    TCLAP::ValueArg<std::string> refineLoopsArg { "", "refine-loops", "Move each loop to the nearest zero crossings (zero), or move its end to where the audio best matches the loop start (correlation).", false, "zero", &refinementConstraint };
+    TCLAP::ValueArg<int> loopSearchArg { "", "loop-search", "How many frames --refine-loops may move a loop point. Defaults to 256.", false, 256, "frames" };
+    
+    TCLAP::SwitchArg bakeCrossfadesArg { "", "bake-crossfades", "Render each zone's loop crossfade into a copy of its sample in [sample-directory] (or next to the output file), so Decent Sampler doesn't have to crossfade while playing.", false };
+    TCLAP::SwitchArg dedupArg { "", "dedup", "Find samples with identical audio and point every zone that uses them at a single copy.", false };
+    TCLAP::SwitchArg collectSamplesArg { "", "collect-samples", "Put every sample the preset uses into [sample-directory], next to the output file. Samples are cloned or hard linked where the filesystem allows it, and copied otherwise.", false };
+    TCLAP::SwitchArg analyseLevelsArg { "", "analyse-levels", "Measure the peak and RMS level of every zone, write them to a .levels.tsv file next to the output, and warn about velocity layers that get quieter as the velocity goes up.", false };
+    TCLAP::SwitchArg levelTrimsArg { "", "level-trims", "Set each zone's volume so that the zones in each velocity layer match the layer's average level. Implies --analyse-levels.", false };
+    
+    std::vector<std::string> consolidationScopes { "preset", "group" };
+    TCLAP::ValuesConstraint<std::string> consolidationConstraint { consolidationScopes };
+    TCLAP::ValueArg<std::string> consolidateArg { "", "consolidate", "Pack the samples into one WAV file per preset or per group, so that Decent Sampler opens a few large files instead of many small ones.", false, "preset", &consolidationConstraint };
+    
+    TCLAP::ValueArg<float> trimSilenceArg { "", "trim-silence", "Trim the silence from the start and end of each zone, treating anything below this level in dB (e.g. -60) as silent. Loops are never cut.", false, -60.0f, "dB" };
+    TCLAP::SwitchArg trimFilesArg { "", "trim-files", "With --trim-silence, write trimmed copies of the samples to [sample-directory] (or next to the output file) instead of only setting each zone's start and end.", false };
+    
+    std::vector<std::string> transcodeFormats = getTranscodeFormats();
+    TCLAP::ValuesConstraint<std::string> transcodeConstraint { transcodeFormats };
+    TCLAP::ValueArg<std::string> transcodeArg { "", "transcode", "Convert every sample to this format and bit depth, writing the results to [sample-directory] (or next to the output file).", false, "wav24", &transcodeConstraint };
+    TCLAP::ValueArg<int> transcodeMemoryArg { "", "transcode-memory", "The most decoded audio, in megabytes, that --transcode holds in memory at once. Defaults to 512.", false, 512, "MB" };
+    
+    TCLAP::SwitchArg physicalOrderArg { "", "physical-order", "Order the zones in each group by where their samples are stored on disk, so that loading the preset reads the disk mostly sequentially.", false };
+    TCLAP::SwitchArg preloadManifestArg { "", "preload-manifest", "Write a .preload file next to the output, listing the preset's samples in load order. \"EXS2DS warm <file>.preload\" then reads them into the page cache ahead of time.", false };
+    
+    TCLAP::ValueArg<int> ioPerDeviceArg { "", "io-per-device", "The most file operations to run at once against any one disk or share when collecting samples. Defaults to 4.", false, 4, "count" };
+    TCLAP::ValueArg<int> metadataPerDeviceArg { "", "metadata-per-device", "The most stat calls and directory listings to run at once against any one disk or share. Defaults to 16.", false, 16, "count" };
+    TCLAP::ValueArg<int> maxOpenFilesArg { "", "max-open-files", "The most sample files to have open at once, or 0 for no limit. Defaults to 256.", false, 256, "count" };
+    TCLAP::ValueArg<int> jobsArg { "j", "jobs", "The number of threads to use for per-sample work. Defaults to one per CPU.", false, 0, "count" };
+    TCLAP::ValueArg<std::string> headerCacheArg { "", "header-cache", "Where to keep sample header information between runs. Defaults to \"" + SampleHeaderCache::getDefaultCacheFile().getFullPathName().toStdString() + "\".", false, "", "file" };
+    TCLAP::SwitchArg noHeaderCacheArg { "", "no-header-cache", "Don't keep sample header information between runs.", false };
+    TCLAP::SwitchArg profileArg { "", "profile", "Print stage timings and counters to stderr when done.", false };
+};
+
+//==============================================================================
+/** EXS2DS watch <source-folder> <output-folder> : converts EXS files as they and their samples change. */
+static int runWatchCommand (int argc, char* argv[])
+{
+    try {
+        
+        TCLAP::CmdLine cmd("Converts every EXS file in a folder, then watches the folder and converts presets again as they or their samples change.", ' ', "1.1.0");
+        TCLAP::UnlabeledValueArg<std::string>  sourceFolderArg( "<source-folder>", "The folder of EXS files to watch, including its subfolders.", true, "", "source-folder"  );
+        cmd.add( sourceFolderArg );
+        
+        TCLAP::UnlabeledValueArg<std::string>  outputFolderArg( "<output-folder>", "Where to write the presets, at the same relative paths as their EXS files. Can be the source folder.", true, "", "output-folder"  );
+        cmd.add( outputFolderArg );
+        
+        TCLAP::UnlabeledValueArg<std::string>  sampleDirectoryArg( "[sample-directory]", "If this optional value is specified, then the presets will look for sample files in this directory.", false, "", "sample-directory"  );
+        cmd.add( sampleDirectoryArg );
+        
+        TCLAP::ValueArg<int> debounceArg( "", "debounce", "How long to wait, in milliseconds, for a burst of changes to finish before converting. Defaults to 500.", false, 500, "ms" );
+        cmd.add( debounceArg );
+        
+        TCLAP::ValueArg<int> pollIntervalArg( "", "poll-interval", "How often, in milliseconds, to rescan the folders for changes where they can't be watched natively (anywhere but Linux). Defaults to 1000.", false, FolderWatcher::defaultPollIntervalMilliseconds, "ms" );
+        cmd.add( pollIntervalArg );
+        
+        ConversionArgs conversionArgs (cmd);
+        cmd.parse( argc, argv );
+        
+        auto sourceFolder = juce::File::getCurrentWorkingDirectory().getChildFile(sourceFolderArg.getValue());
+        auto outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile(outputFolderArg.getValue());
+        
+        if(!sourceFolder.isDirectory()) {
+            std::cerr << "\"" << sourceFolderArg.getValue() << "\" is not a folder." << std::endl;
+            return 2;
+        }
+        
+        if(sourceFolder.isAChildOf(outputFolder)) {
+            std::cerr << "The output folder can't contain the source folder." << std::endl;
+            return 2;
+        }
+        
+        auto options = conversionArgs.getOptions(sampleDirectoryArg.getValue());
+        if(options.collectSamples && options.sampleDirectory.isEmpty()) {
+            std::cerr << "--collect-samples needs a [sample-directory] to collect the samples into." << std::endl;
+            return 2;
+        }
+        
+        auto contextOptions = conversionArgs.getContextOptions();
+        contextOptions.keepParsedPresets = true;
+        
+        // Ctrl-C lets the preset being converted finish, and saves the header cache.
+        InterruptHandler::install();
+        
+        ConversionContext context (contextOptions);
+        WatchFolder watchFolder (sourceFolder, outputFolder, options, context, juce::jmax(1, pollIntervalArg.getValue()));
+        watchFolder.convertOutOfDatePresets();
+        watchFolder.run(juce::jmax(0, debounceArg.getValue()));
+        
+        return InterruptHandler::getExitCode();
+        
+    } catch (TCLAP::ArgException &e)
+    { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
+    
+    return 2;
+}
+
+//==============================================================================
+/** EXS2DS batch --manifest <jobs.jsonl> : converts every job listed in a manifest. */
+static int runBatchCommand (int argc, char* argv[])
+{
+    try {
+        
+        TCLAP::CmdLine cmd("Converts every job in a manifest, a file with one JSON job per line, several presets at a time.", ' ', "1.1.0");
+        TCLAP::ValueArg<std::string> manifestArg( "", "manifest", "The manifest of jobs to convert.", true, "", "jobs.jsonl" );
+        cmd.add( manifestArg );
+        
+        TCLAP::ValueArg<int> workersArg( "", "workers", "The number of presets to run the sample stages for at once. Defaults to one per CPU.", false, 0, "count" );
+        cmd.add( workersArg );
+        
+        TCLAP::ValueArg<std::string> stageWorkersArg( "", "stage-workers", "The number of threads for each of the other stages: parsing, finding samples, serialising and writing. Defaults to 2,4,2,4.", false, "2,4,2,4", "P,F,S,W" );
+        cmd.add( stageWorkersArg );
+        
+        TCLAP::ValueArg<std::string> shardArg( "", "shard", "Only convert this machine's share of the jobs, e.g. 2/4 for the second of four shards. Every job belongs to exactly one shard.", false, "1/1", "K/N" );
+        cmd.add( shardArg );
+        
+        TCLAP::ValueArg<std::string> journalArg( "", "journal", "Where to record the jobs that have finished. Defaults to the manifest's path with .journal added, or with .shard-K-of-N.journal for a shard.", false, "", "file" );
+        cmd.add( journalArg );
+        
+        TCLAP::ValueArg<int> memoryArg( "", "memory", "The most memory, in megabytes, that the presets being converted are estimated to need at once. Defaults to half the machine's memory.", false, juce::SystemStats::getMemorySizeInMegabytes() / 2, "MB" );
+        cmd.add( memoryArg );
+        
+        TCLAP::ValueArg<int> lookaheadArg( "", "lookahead", "How many jobs to read ahead of the workers, so that the biggest can be started first.", false, BatchRunner::defaultLookahead, "jobs" );
+        cmd.add( lookaheadArg );
+        
+        TCLAP::SwitchArg resumeArg( "", "resume", "Skip the jobs the journal shows have already been converted, as long as their EXS file and preset haven't changed since.", false );
+        cmd.add( resumeArg );
+        
+        ConversionArgs conversionArgs (cmd);
+        cmd.parse( argc, argv );
+        
+        juce::String shard (shardArg.getValue());
+        auto shardNumber = shard.upToFirstOccurrenceOf("/", false, false).getIntValue();
+        auto numShards = shard.fromFirstOccurrenceOf("/", false, false).getIntValue();
+        if(!shard.containsChar('/') || numShards < 1 || shardNumber < 1 || shardNumber > numShards) {
+            std::cerr << "--shard must be K/N, with K from 1 to N." << std::endl;
+            return 2;
+        }
+        
+        auto stageWorkers = juce::StringArray::fromTokens(juce::String(stageWorkersArg.getValue()), ",", "");
+        ConversionPipeline::Options pipelineOptions;
+        pipelineOptions.numParseWorkers = stageWorkers[0].getIntValue();
+        pipelineOptions.numResolveWorkers = stageWorkers[1].getIntValue();
+        pipelineOptions.numSerialiseWorkers = stageWorkers[2].getIntValue();
+        pipelineOptions.numWriteWorkers = stageWorkers[3].getIntValue();
+        if(stageWorkers.size() != 4 || pipelineOptions.numParseWorkers < 1 || pipelineOptions.numResolveWorkers < 1
+            || pipelineOptions.numSerialiseWorkers < 1 || pipelineOptions.numWriteWorkers < 1) {
+            std::cerr << "--stage-workers must be four counts of at least 1, e.g. 2,4,2,4." << std::endl;
+            return 2;
+        }
+        
+        auto manifestFile = juce::File::getCurrentWorkingDirectory().getChildFile(manifestArg.getValue());
+        auto journalFile = journalArg.isSet() ? juce::File::getCurrentWorkingDirectory().getChildFile(journalArg.getValue())
+                                              : manifestFile.getSiblingFile(manifestFile.getFileName()
+                                                                            + (numShards > 1 ? ".shard-" + juce::String(shardNumber) + "-of-" + juce::String(numShards) : juce::String())
+                                                                            + ".journal");
+        
+        BatchJournal journal;
+        auto opened = resumeArg.getValue() ? journal.load(journalFile) : juce::Result::ok();
+        if(opened.wasOk())
+            opened = journal.open(journalFile, resumeArg.getValue());
+        
+        if(opened.failed()) {
+            std::cerr << opened.getErrorMessage() << std::endl;
+            return 2;
+        }
+        
+        ConversionContext context (conversionArgs.getContextOptions());
+        BatchRunner runner (conversionArgs.getOptions({}), context, workersArg.getValue());
+        runner.setShard(shardNumber, numShards);
+        runner.setPipelineOptions(pipelineOptions);
+        runner.setLookahead(juce::jmax(lookaheadArg.getValue(), 1));
+        runner.setMemoryBudget((juce::int64) juce::jmax(1, memoryArg.getValue()) * 1024 * 1024);
+        runner.setJournal(&journal, resumeArg.getValue());
+        
+        // Ctrl-C stops new jobs from starting rather than killing the ones being written.
+        InterruptHandler::install();
+        auto result = runner.run(manifestFile);
+        
+        conversionArgs.printSummary(context);
+        
+        if(result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 2;
+        }
+        
+        std::cerr << "Converted " << runner.getNumSucceeded() << " presets";
+        if(runner.getNumFailed() > 0)
+            std::cerr << ", " << runner.getNumFailed() << " failed";
+        if(runner.getNumAlreadyComplete() > 0)
+            std::cerr << ", " << runner.getNumAlreadyComplete() << " already done";
+        if(numShards > 1)
+            std::cerr << " (" << runner.getNumInOtherShards() << " jobs belong to other shards)";
+        std::cerr << "." << std::endl;
+        
+        if(runner.wasCancelled()) {
+            std::cerr << "Interrupted with " << runner.getNumNotStarted() << " queued jobs not converted, as well as any further down the manifest. "
+                      << "Run the same command with --resume to finish them." << std::endl;
+            return InterruptHandler::getExitCode();
+        }
+        
+        return runner.getNumFailed() > 0 ? 1 : 0;
+        
+    } catch (TCLAP::ArgException &e)
+    { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
+    
+    return 2;
+}
+
+//==============================================================================
+/** EXS2DS serve --socket <path> : converts presets sent as JSON by other programs. */
+static int runServeCommand (int argc, char* argv[])
+{
+    try {
+        
+        TCLAP::CmdLine cmd("Listens for conversion jobs, sent as one line of JSON each, and converts them with the sample index kept in memory between jobs.", ' ', "1.1.0");
+        TCLAP::ValueArg<std::string> socketArg( "", "socket", "The Unix domain socket to listen on.", false, "", "path" );
+        cmd.add( socketArg );
+        
+        TCLAP::ValueArg<int> portArg( "", "port", "A TCP port to listen on, on 127.0.0.1 only, instead of a socket. Needs --token-file.", false, 0, "port" );
+        cmd.add( portArg );
+        
+        TCLAP::ValueArg<std::string> tokenFileArg( "", "token-file", "A file holding a secret that every job must give in its \"token\" field.", false, "", "path" );
+        cmd.add( tokenFileArg );
+        
+        TCLAP::ValueArg<std::string> outputRootArg( "", "output-root", "Refuse jobs that would write anything outside this folder.", false, "", "path" );
+        cmd.add( outputRootArg );
+        
+        TCLAP::ValueArg<int> workersArg( "", "workers", "The most jobs to convert at once, across every connection. Defaults to one per CPU.", false, 0, "count" );
+        cmd.add( workersArg );
+        
+        TCLAP::ValueArg<int> connectionsArg( "", "max-connections", "The most connections to serve at once. Defaults to 64.", false, 64, "count" );
+        cmd.add( connectionsArg );
+        
+        ConversionArgs conversionArgs (cmd);
+        cmd.parse( argc, argv );
+        
+        if(socketArg.isSet() == portArg.isSet()) {
+            std::cerr << "serve needs either --socket or --port." << std::endl;
+            return 2;
+        }
+        
+        ConversionServer::Options serverOptions;
+        serverOptions.numWorkers = workersArg.getValue();
+        serverOptions.maxConnections = connectionsArg.getValue();
+        
+        if(tokenFileArg.isSet()) {
+            auto tokenFile = juce::File::getCurrentWorkingDirectory().getChildFile(tokenFileArg.getValue());
+            serverOptions.token = tokenFile.loadFileAsString().trim();
+            
+            if(serverOptions.token.isEmpty()) {
+                std::cerr << "Couldn't read a token from \"" << tokenFile.getFullPathName() << "\"." << std::endl;
+                return 2;
+            }
+        }
+        
+        if(outputRootArg.isSet())
+            serverOptions.outputRoot = juce::File::getCurrentWorkingDirectory().getChildFile(outputRootArg.getValue());
+        
+        ConversionContext context (conversionArgs.getContextOptions());
+        ConversionServer server (conversionArgs.getOptions({}), context, serverOptions);
+        
+        auto result = socketArg.isSet() ? server.listenOnSocket(juce::File::getCurrentWorkingDirectory().getChildFile(socketArg.getValue()))
+                                        : server.listenOnPort(portArg.getValue());
+        if(result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+        
+        server.run();
+        
+    } catch (TCLAP::ArgException &e)
+    { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
+    
+    return 2;
+}
 
 //==============================================================================
 int main (int argc, char* argv[])
 {
+    if(argc > 1 && juce::String(argv[1]) == "warm")
+        return runWarmCommand(argc - 1, argv + 1);
+    
+    if(argc > 1 && juce::String(argv[1]) == "watch")
+        return runWatchCommand(argc - 1, argv + 1);
+    
+    if(argc > 1 && juce::String(argv[1]) == "serve")
+        return runServeCommand(argc - 1, argv + 1);
+    
+    if(argc > 1 && juce::String(argv[1]) == "batch")
+        return runBatchCommand(argc - 1, argv + 1);
+    
     // Wrap everything in a try block.  Do this every time,
     // because exceptions will be thrown for problems.
     try {
 
         TCLAP::CmdLine cmd("A command-line utility that converts Logic Sampler (EXS) files to DecentSampler format. At this point, it handles only the most basic mappings, but it's a start.", ' ', "1.1.0");
-        TCLAP::UnlabeledValueArg<std::string>  inputFileArg( "<exs-file>", "The EXS file to convert.", true, "", "exs-file"  );
+        TCLAP::UnlabeledValueArg<std::string>  inputFileArg( "<exs-file>", "The EXS file to convert, or - to read it from stdin. Samples are then looked for in the current directory.", true, "", "exs-file"  );
         cmd.add( inputFileArg );
             
-        TCLAP::UnlabeledValueArg<std::string>  outputFileArg( "<ds-preset-file>", "The Decent Sampler files to write out. WARNING: If the file already exists it will be overwritten.", true, "", "ds-preset-file"  );
+        TCLAP::UnlabeledValueArg<std::string>  outputFileArg( "<ds-preset-file>", "The Decent Sampler files to write out, or - to write the preset to stdout. WARNING: If the file already exists it will be overwritten.", true, "", "ds-preset-file"  );
         cmd.add( outputFileArg );
         
         TCLAP::UnlabeledValueArg<std::string>  sampleDirectoryArg( "[sample-directory]", "If this optional value is specified, then the output file will look for sample files in this directory.", false, "", "sample-directory"  );
         cmd.add( sampleDirectoryArg );
         
+        ConversionArgs conversionArgs (cmd);
+        
 //        TCLAP::UnlabeledValueArg<std::string>  sampleDirectoryArg( "[sample-directory]", "The Decent Sampler files to write out. WARNING: If the file already exists it will be overwritten.", true, "", "ds-preset-file"  );
 //        cmd.add( outputFileArg );
             
         // Parse the argv array.
         cmd.parse( argc, argv );
 
-        juce::File inputFile = juce::File(inputFileArg.getValue());
-        if(!inputFile.existsAsFile()) {
-            std::cerr << "\"" << inputFileArg.getValue() << "\" is not a file." << std::endl;
-            return 2;
-        }
-        
-        juce::File outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(outputFileArg.getValue());
-//        juce::String sampleDir;
-//        if(argc == 4) {
-//            sampleDir = argv[3];
-//        }
+        auto options = conversionArgs.getOptions(sampleDirectoryArg.getValue());
         
-        DSEXS24 exs;
-        exs.loadExs(inputFile);
-        
-        DSPresetConverter presetMaker;
-        presetMaker.parseDSEXS24(exs);
-        
-        
-        juce::String possibleSampleDirectory = sampleDirectoryArg.getValue();
-        if(possibleSampleDirectory.isEmpty()) {
-            possibleSampleDirectory = inputFile.getFileNameWithoutExtension();
+        // "-" reads the EXS from stdin. It's treated as if it were in the current
+        // directory, so that's where its samples are looked for.
+        juce::MemoryBlock inputData;
+        if(inputFileArg.getValue() == "-") {
+            if(!readStandardInput(inputData)) {
+                std::cerr << "Couldn't read the EXS file from stdin." << std::endl;
+                return 2;
+            }
+            
+            options.inputFile = juce::File::getCurrentWorkingDirectory().getChildFile("stdin.exs");
+            options.inputData = &inputData;
+        } else {
+            juce::File inputFile = juce::File(inputFileArg.getValue());
+            if(!inputFile.existsAsFile()) {
+                std::cerr << "\"" << inputFileArg.getValue() << "\" is not a file." << std::endl;
+                return 2;
+            }
+            
+            options.inputFile = inputFile;
         }
-        presetMaker.huntForSamples(inputFile.getParentDirectory(), possibleSampleDirectory);
-        
-        presetMaker.convertEXSLoopCrossfadePoints();
         
-        juce::String desiredSamplePath = sampleDirectoryArg.getValue();
-        if(desiredSamplePath.isNotEmpty())
-            presetMaker.convertPathsToDesiredDirectory(inputFile.getParentDirectory(), possibleSampleDirectory);
-        else
-            presetMaker.convertPathsToRelative(inputFile.getParentDirectory());
+        // "-" writes the preset to stdout. Anything written next to it goes in
+        // the current directory.
+        StandardOutputStream standardOutput;
+        if(outputFileArg.getValue() == "-") {
+            options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.inputFile.getFileNameWithoutExtension() + ".dspreset");
+            options.outputStream = &standardOutput;
+        } else {
+            options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(outputFileArg.getValue());
+        }
         
-        DBG(presetMaker.getXML());
+        if(options.collectSamples && options.sampleDirectory.isEmpty()) {
+            std::cerr << "--collect-samples needs a [sample-directory] to collect the samples into." << std::endl;
+            return 2;
+        }
 
-        
-        if(outputFile.existsAsFile()) {
-            outputFile.deleteFile();
-    //        std::cerr << "File \"" << argv[1] << "\" exists already." << std::endl;
-    ////        return 3;
+        ConversionContext context (conversionArgs.getContextOptions());
+        auto result = convertPreset(options, context);
+        standardOutput.flush();
+
+        conversionArgs.printSummary(context);
+
+        if(result.failed()) {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
         }
-    //
-        outputFile.create();
-        outputFile.appendText(presetMaker.getXML());
         
     } catch (TCLAP::ArgException &e)  // catch exceptions
     { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
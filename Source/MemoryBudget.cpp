@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    MemoryBudget.cpp
+
+  ==============================================================================
+*/
+
+#include "MemoryBudget.h"
+
+//==============================================================================
+MemoryBudget::MemoryBudget (juce::int64 maximum)
+    : maxBytes (juce::jmax ((juce::int64) 1, maximum))
+{
+}
+
+void MemoryBudget::reserve (juce::int64 bytes)
+{
+    std::unique_lock<std::mutex> ul (mutex);
+    bytesReleased.wait (ul, [&] { return reservedBytes == 0 || reservedBytes + bytes <= maxBytes; });
+    reservedBytes += bytes;
+}
+
+void MemoryBudget::release (juce::int64 bytes)
+{
+    {
+        std::lock_guard<std::mutex> lg (mutex);
+        reservedBytes -= bytes;
+    }
+
+    bytesReleased.notify_all();
+}
+
+//==============================================================================
+MemoryBudget::ScopedReservation::ScopedReservation (MemoryBudget& b, juce::int64 numBytes)
+    : budget (b), bytes (numBytes)
+{
+    budget.reserve (bytes);
+}
+
+MemoryBudget::ScopedReservation::~ScopedReservation()
+{
+    budget.release (bytes);
+}
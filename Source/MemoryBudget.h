@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    MemoryBudget.h
+
+    Limits how much memory concurrent jobs can hold at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <condition_variable>
+#include <mutex>
+
+//==============================================================================
+/**
+    A pool of bytes that jobs reserve before allocating large buffers, and wait
+    on when it's used up.
+
+    A reservation larger than the whole budget is allowed once nothing else is
+    reserved, so an oversized job runs alone rather than never.
+*/
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget (juce::int64 maxBytes);
+
+    /** Waits until the bytes fit in the budget, then reserves them. */
+    void reserve (juce::int64 bytes);
+
+    /** Gives back bytes taken by reserve(). */
+    void release (juce::int64 bytes);
+
+    juce::int64 getMaxBytes() const noexcept            { return maxBytes; }
+
+    //==============================================================================
+    /** Holds a reservation for as long as it exists. */
+    class ScopedReservation
+    {
+    public:
+        ScopedReservation (MemoryBudget& budget, juce::int64 bytes);
+        ~ScopedReservation();
+
+    private:
+        MemoryBudget& budget;
+        const juce::int64 bytes;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedReservation)
+    };
+
+private:
+    const juce::int64 maxBytes;
+    std::mutex mutex;
+    std::condition_variable bytesReleased;
+    juce::int64 reservedBytes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (MemoryBudget)
+};
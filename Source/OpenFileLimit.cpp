@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    OpenFileLimit.cpp
+
+  ==============================================================================
+*/
+
+#include "OpenFileLimit.h"
+#include <condition_variable>
+#include <mutex>
+
+//==============================================================================
+namespace
+{
+    struct OpenFiles
+    {
+        std::mutex mutex;
+        std::condition_variable fileClosed;
+        int maximum = 0, numOpen = 0;
+    };
+
+    OpenFiles& getOpenFiles()
+    {
+        static OpenFiles openFiles;
+        return openFiles;
+    }
+
+    thread_local int numOpenOnThisThread = 0;
+}
+
+//==============================================================================
+void OpenFileLimit::setMaximum (int maxOpenFiles)
+{
+    auto& openFiles = getOpenFiles();
+    {
+        std::lock_guard<std::mutex> lg (openFiles.mutex);
+        openFiles.maximum = juce::jmax (0, maxOpenFiles);
+    }
+
+    openFiles.fileClosed.notify_all();
+}
+
+int OpenFileLimit::getMaximum()
+{
+    auto& openFiles = getOpenFiles();
+    std::lock_guard<std::mutex> lg (openFiles.mutex);
+    return openFiles.maximum;
+}
+
+//==============================================================================
+OpenFileLimit::ScopedFile::ScopedFile()
+{
+    auto& openFiles = getOpenFiles();
+    std::unique_lock<std::mutex> ul (openFiles.mutex);
+
+    if(numOpenOnThisThread == 0)
+        openFiles.fileClosed.wait (ul, [&] { return openFiles.maximum == 0 || openFiles.numOpen < openFiles.maximum; });
+
+    ++openFiles.numOpen;
+    ++numOpenOnThisThread;
+}
+
+OpenFileLimit::ScopedFile::~ScopedFile()
+{
+    auto& openFiles = getOpenFiles();
+    {
+        std::lock_guard<std::mutex> lg (openFiles.mutex);
+        --openFiles.numOpen;
+        --numOpenOnThisThread;
+    }
+
+    openFiles.fileClosed.notify_one();
+}
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    OpenFileLimit.h
+
+    Limits how many sample files the process has open at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A process-wide limit on the files that conversions hold open, shared by
+    every stage that reads or writes samples. Opening a file waits until one
+    of the others is closed.
+
+    A thread that already has a file open can always open more, so a stage
+    that reads one file while writing another can't deadlock against the
+    others. The limit can therefore be exceeded by a file or two per thread.
+*/
+struct OpenFileLimit
+{
+    /** Sets the most files to have open at once, or 0 for no limit. */
+    static void setMaximum (int maxOpenFiles);
+
+    static int getMaximum();
+
+    //==============================================================================
+    /** Counts as one open file for as long as it exists. */
+    class ScopedFile
+    {
+    public:
+        ScopedFile();
+        ~ScopedFile();
+
+    private:
+        JUCE_DECLARE_NON_COPYABLE (ScopedFile)
+    };
+};
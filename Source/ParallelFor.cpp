@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    ParallelFor.cpp
+
+  ==============================================================================
+*/
+
+#include "ParallelFor.h"
+
+//==============================================================================
+namespace
+{
+    /** Shared between the caller and its helper jobs. Helpers that only get to
+        run after the caller has returned find it closed and do nothing.
+    */
+    struct ParallelLoop
+    {
+        ParallelLoop (int n, const std::function<void (int)>& b)  : numItems (n), body (b) {}
+
+        void runItems()
+        {
+            for(int i = nextItem++; i < numItems; i = nextItem++)
+                body (i);
+        }
+
+        void runHelper()
+        {
+            {
+                const juce::ScopedLock sl (lock);
+                if(isClosed)
+                    return;
+
+                ++numActiveHelpers;
+            }
+
+            runItems();
+
+            const juce::ScopedLock sl (lock);
+            if(--numActiveHelpers == 0 && isClosed)
+                allHelpersFinished.signal();
+        }
+
+        void finish()
+        {
+            runItems();
+
+            {
+                const juce::ScopedLock sl (lock);
+                isClosed = true;
+                if(numActiveHelpers == 0)
+                    return;
+            }
+
+            allHelpersFinished.wait();
+        }
+
+        const int numItems;
+        const std::function<void (int)> body;
+        std::atomic<int> nextItem { 0 };
+
+        juce::CriticalSection lock;
+        int numActiveHelpers = 0;
+        bool isClosed = false;
+        juce::WaitableEvent allHelpersFinished;
+    };
+}
+
+//==============================================================================
+void parallelFor (juce::ThreadPool& pool, int numItems, const std::function<void (int)>& body)
+{
+    if(numItems <= 0)
+        return;
+
+    auto loop = std::make_shared<ParallelLoop> (numItems, body);
+    auto numHelpers = juce::jmin (pool.getNumThreads(), numItems - 1);
+
+    for(int i = 0; i < numHelpers; ++i)
+        pool.addJob ([loop] { loop->runHelper(); });
+
+    loop->finish();
+}
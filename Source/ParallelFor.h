@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+
+    ParallelFor.h
+
+    Runs a loop body across a thread pool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Calls body (i) for every i in [0, numItems), spreading the calls across the
+    pool's threads, and returns once they have all finished.
+
+    The calling thread works through items too, so it's safe to call this from
+    inside a job that is already running on the same pool.
+*/
+void parallelFor (juce::ThreadPool& pool, int numItems, const std::function<void (int)>& body);
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    PhysicalLayout.cpp
+
+  ==============================================================================
+*/
+
+#include "PhysicalLayout.h"
+#include "ParallelFor.h"
+#include <map>
+#include <tuple>
+
+#if JUCE_LINUX
+ #include <fcntl.h>
+ #include <linux/fiemap.h>
+ #include <linux/fs.h>
+ #include <sys/ioctl.h>
+#endif
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    struct Position
+    {
+        juce::uint64 device = 0;
+        bool isInodeOrder = true;     // inode numbers and byte offsets can't be compared with each other
+        juce::uint64 location = 0;
+
+        bool operator< (const Position& other) const
+        {
+            return std::tie (device, isInodeOrder, location) < std::tie (other.device, other.isInodeOrder, other.location);
+        }
+    };
+
+    bool getFirstExtentOffset (const juce::File& file, juce::uint64& offset)
+    {
+       #if JUCE_LINUX
+        auto fd = open (file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return false;
+
+        alignas (struct fiemap) char request[sizeof (struct fiemap) + sizeof (struct fiemap_extent)] = {};
+        auto* map = reinterpret_cast<struct fiemap*> (request);
+        map->fm_start = 0;
+        map->fm_length = FIEMAP_MAX_OFFSET;
+        map->fm_extent_count = 1;
+
+        auto found = ioctl (fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0
+                        && (map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN) == 0;
+        close (fd);
+
+        if(found)
+            offset = (juce::uint64) map->fm_extents[0].fe_physical;
+
+        return found;
+       #else
+        juce::ignoreUnused (file, offset);
+        return false;
+       #endif
+    }
+
+    Position getPosition (const juce::File& file, ProfileStats& stats)
+    {
+        Position position;
+
+       #if ! JUCE_WINDOWS
+        struct stat info;
+        stats.add ("metadata.stats");
+        if(stat (file.getFullPathName().toRawUTF8(), &info) == 0) {
+            position.device = (juce::uint64) info.st_dev;
+            position.location = (juce::uint64) info.st_ino;
+        }
+       #endif
+
+        if(getFirstExtentOffset (file, position.location)) {
+            position.isInodeOrder = false;
+            stats.add ("layout.extentsFound");
+        } else {
+            stats.add ("layout.inodeFallbacks");
+        }
+
+        return position;
+    }
+}
+
+//==============================================================================
+void sortSamplesByPhysicalLayout (PresetDocument& preset, ProfileStats& stats, juce::ThreadPool& pool)
+{
+    auto files = preset.getUniqueSampleFiles();
+    std::vector<Position> positions ((size_t) files.size());
+
+    parallelFor (pool, files.size(), [&] (int i) { positions[(size_t) i] = getPosition (files.getReference (i), stats); });
+
+    std::map<juce::String, Position> positionsByPath;
+    for(int i = 0; i < files.size(); ++i)
+        positionsByPath[files.getReference (i).getFullPathName()] = positions[(size_t) i];
+
+    for(auto* group : preset.getGroups()) {
+        std::vector<juce::XmlElement*> samples;
+        std::vector<int> slots;
+
+        for(int i = 0; i < group->getNumChildElements(); ++i) {
+            auto* child = group->getChildElement (i);
+            if(child->hasTagName ("sample")) {
+                samples.push_back (child);
+                slots.push_back (i);
+            }
+        }
+
+        auto sorted = samples;
+        std::stable_sort (sorted.begin(), sorted.end(), [&] (juce::XmlElement* a, juce::XmlElement* b)
+        {
+            return positionsByPath[preset.getSampleFile (*a).getFullPathName()]
+                    < positionsByPath[preset.getSampleFile (*b).getFullPathName()];
+        });
+
+        if(sorted == samples)
+            continue;
+
+        // Put the samples back into the same slots, so other children don't move.
+        for(auto* sample : samples)
+            group->removeChildElement (sample, false);
+
+        for(size_t i = 0; i < sorted.size(); ++i)
+            group->insertChildElement (sorted[i], slots[i]);
+
+        stats.add ("layout.groupsReordered");
+    }
+}
@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+    PhysicalLayout.h
+
+    Orders a preset's zones by where their samples are stored on disk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+
+//==============================================================================
+/**
+    Reorders the <sample> elements inside each <group> so their files appear in
+    the order they are laid out on disk. Decent Sampler loads samples in
+    preset order, so on a spinning disk this turns a cold load into mostly
+    sequential reads.
+
+    On Linux, a file's position is the physical offset of its first extent,
+    from FIEMAP. Where that isn't available (other platforms, or filesystems
+    that don't support FIEMAP), files are ordered by inode number, which most
+    filesystems allocate roughly in the order files were written. Files are
+    grouped by device first. Anything else in a group keeps its place, and
+    samples whose positions are equal keep their order.
+
+    The positions are looked up in parallel on the pool.
+*/
+void sortSamplesByPhysicalLayout (PresetDocument& preset, ProfileStats& stats, juce::ThreadPool& pool);
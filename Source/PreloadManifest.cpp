@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    PreloadManifest.cpp
+
+  ==============================================================================
+*/
+
+#include "PreloadManifest.h"
+#include "ParallelFor.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    const char* const manifestIdentifier = "EXS2DS preload manifest 1";
+
+    /** Returns false if the file couldn't be opened. */
+    bool warmFile (const PreloadManifest::Entry& entry)
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        auto fd = open (entry.file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return false;
+
+        auto length = (size_t) juce::jmax ((juce::int64) 0, entry.size);
+
+       #if JUCE_LINUX
+        // readahead() blocks until the data is cached; the fadvise hint is for
+        // filesystems that don't support it.
+        if(readahead (fd, 0, length) != 0)
+            posix_fadvise (fd, 0, (off_t) length, POSIX_FADV_WILLNEED);
+       #else
+        struct radvisory advice;
+        advice.ra_offset = 0;
+        advice.ra_count = (int) juce::jmin (length, (size_t) std::numeric_limits<int>::max());
+        fcntl (fd, F_RDADVISE, &advice);
+       #endif
+
+        close (fd);
+        return true;
+       #else
+        juce::FileInputStream stream (entry.file);
+        if(! stream.openedOk())
+            return false;
+
+        juce::HeapBlock<char> buffer (1024 * 1024);
+        while(stream.read (buffer, 1024 * 1024) > 0) {}
+        return true;
+       #endif
+    }
+}
+
+//==============================================================================
+PreloadManifest PreloadManifest::fromPreset (const PresetDocument& preset, SampleHeaderCache& headers)
+{
+    PreloadManifest manifest;
+
+    for(auto& file : preset.getUniqueSampleFiles())
+        manifest.entries.push_back ({ file, headers.getFileSize (file) });
+
+    return manifest;
+}
+
+juce::Result PreloadManifest::save (const juce::File& manifestFile) const
+{
+    juce::MemoryOutputStream out;
+    out << manifestIdentifier << "\n";
+
+    for(auto& entry : entries)
+        out << entry.size << "\t" << entry.file.getFullPathName() << "\n";
+
+    if(! manifestFile.replaceWithData (out.getData(), out.getDataSize()))
+        return juce::Result::fail ("Couldn't write \"" + manifestFile.getFullPathName() + "\".");
+
+    return juce::Result::ok();
+}
+
+juce::Result PreloadManifest::load (const juce::File& manifestFile, PreloadManifest& result)
+{
+    juce::StringArray lines;
+    manifestFile.readLines (lines);
+
+    if(lines.isEmpty() || lines[0] != manifestIdentifier)
+        return juce::Result::fail ("\"" + manifestFile.getFullPathName() + "\" is not a preload manifest.");
+
+    result.entries.clear();
+
+    for(int i = 1; i < lines.size(); ++i) {
+        auto tab = lines[i].indexOfChar ('\t');
+        if(tab <= 0)
+            continue;
+
+        result.entries.push_back ({ juce::File (lines[i].substring (tab + 1)), lines[i].substring (0, tab).getLargeIntValue() });
+    }
+
+    return juce::Result::ok();
+}
+
+int PreloadManifest::warm (juce::ThreadPool& pool, ProfileStats& stats) const
+{
+    std::atomic<int> numFailed { 0 };
+
+    parallelFor (pool, (int) entries.size(), [&] (int i)
+    {
+        auto& entry = entries[(size_t) i];
+
+        if(warmFile (entry)) {
+            stats.add ("warm.files");
+            stats.add ("warm.bytes", entry.size);
+        } else {
+            ++numFailed;
+        }
+    });
+
+    return numFailed;
+}
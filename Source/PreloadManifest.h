@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    PreloadManifest.h
+
+    A list of the files a preset loads, for warming the page cache before the
+    preset is used.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+
+//==============================================================================
+/**
+    The sample files a preset uses, with their sizes, in the order the preset
+    references them.
+
+    It's saved as a small text file next to the preset, and the warm command
+    reads it back to pull the samples into the page cache ahead of time.
+*/
+struct PreloadManifest
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 size = 0;
+    };
+
+    std::vector<Entry> entries;
+
+    /** Lists the samples a preset uses. The paths must still be absolute, so
+        this has to happen before the preset's paths are converted.
+    */
+    static PreloadManifest fromPreset (const PresetDocument& preset, SampleHeaderCache& headers);
+
+    juce::Result save (const juce::File& manifestFile) const;
+    static juce::Result load (const juce::File& manifestFile, PreloadManifest& result);
+
+    /** Asks the OS to read every file into the page cache, in parallel on the
+        pool, and returns once it has. Uses readahead() on Linux and
+        F_RDADVISE on macOS; elsewhere the files are simply read through.
+        Returns the number of files that couldn't be opened.
+    */
+    int warm (juce::ThreadPool& pool, ProfileStats& stats) const;
+};
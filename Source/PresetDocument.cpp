@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    PresetDocument.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetDocument.h"
+#include <set>
+
+//==============================================================================
+static void collectSamples (juce::XmlElement& element, juce::Array<juce::XmlElement*>& samples)
+{
+    for(auto* child : element.getChildIterator()) {
+        if(child->hasTagName ("sample"))
+            samples.add (child);
+        else
+            collectSamples (*child, samples);
+    }
+}
+
+static void collectGroups (juce::XmlElement& element, juce::Array<juce::XmlElement*>& groups)
+{
+    for(auto* child : element.getChildIterator()) {
+        if(child->hasTagName ("group"))
+            groups.add (child);
+        else
+            collectGroups (*child, groups);
+    }
+}
+
+//==============================================================================
+PresetDocument::PresetDocument (std::unique_ptr<juce::XmlElement> rootElement, const juce::File& sampleBaseDirectory)
+    : root (std::move (rootElement)), baseDirectory (sampleBaseDirectory)
+{
+    jassert (root != nullptr);
+}
+
+std::unique_ptr<PresetDocument> PresetDocument::parse (const juce::String& xml, const juce::File& sampleBaseDirectory)
+{
+    auto rootElement = juce::parseXML (xml);
+    if(rootElement == nullptr)
+        return nullptr;
+
+    return std::make_unique<PresetDocument> (std::move (rootElement), sampleBaseDirectory);
+}
+
+//==============================================================================
+juce::Array<juce::XmlElement*> PresetDocument::getSamples() const
+{
+    return getSamplesIn (*root);
+}
+
+juce::Array<juce::XmlElement*> PresetDocument::getSamplesIn (juce::XmlElement& element)
+{
+    juce::Array<juce::XmlElement*> samples;
+    collectSamples (element, samples);
+    return samples;
+}
+
+juce::Array<juce::XmlElement*> PresetDocument::getGroups() const
+{
+    juce::Array<juce::XmlElement*> groups;
+    collectGroups (*root, groups);
+    return groups;
+}
+
+juce::Array<juce::File> PresetDocument::getUniqueSampleFiles() const
+{
+    juce::Array<juce::File> files;
+    std::set<juce::String> seen;
+
+    for(auto* sample : getSamples()) {
+        auto file = getSampleFile (*sample);
+        if(seen.insert (file.getFullPathName()).second)
+            files.add (file);
+    }
+
+    return files;
+}
+
+juce::File PresetDocument::getSampleFile (const juce::XmlElement& sample) const
+{
+    // getChildFile() treats an absolute path as-is.
+    return baseDirectory.getChildFile (sample.getStringAttribute ("path"));
+}
+
+void PresetDocument::setSampleFile (juce::XmlElement& sample, const juce::File& file)
+{
+    sample.setAttribute ("path", file.getFullPathName());
+}
+
+//==============================================================================
+void PresetDocument::convertPathsToRelative (const juce::File& directory)
+{
+    for(auto* sample : getSamples())
+        sample->setAttribute ("path", getSampleFile (*sample).getRelativePathFrom (directory).replaceCharacter ('\\', '/'));
+}
+
+void PresetDocument::convertPathsToDesiredDirectory (const juce::String& desiredDirectory)
+{
+    auto directory = desiredDirectory.replaceCharacter ('\\', '/').trimCharactersAtEnd ("/");
+
+    for(auto* sample : getSamples())
+        sample->setAttribute ("path", directory + "/" + getSampleFile (*sample).getFileName());
+}
+
+juce::String PresetDocument::toString() const
+{
+    return root->toString();
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    PresetDocument.h
+
+    The generated Decent Sampler preset, held as XML so that the stages after
+    DSPresetConverter can work on its <sample> elements.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Wraps the XML produced by DSPresetConverter::getXML().
+
+    Until one of the convertPaths methods is called, every sample path is
+    treated as a file: relative paths are resolved against the directory given
+    to the constructor, which is where the EXS file lives.
+*/
+class PresetDocument
+{
+public:
+    PresetDocument (std::unique_ptr<juce::XmlElement> rootElement, const juce::File& sampleBaseDirectory);
+
+    /** Parses a preset, returning nullptr if the XML is not valid. */
+    static std::unique_ptr<PresetDocument> parse (const juce::String& xml, const juce::File& sampleBaseDirectory);
+
+    //==============================================================================
+    /** Returns every <sample> element in the order they appear in the preset. */
+    juce::Array<juce::XmlElement*> getSamples() const;
+
+    /** Returns every <sample> element inside an element of the preset. */
+    static juce::Array<juce::XmlElement*> getSamplesIn (juce::XmlElement& element);
+
+    /** Returns every <group> element in the order they appear in the preset. */
+    juce::Array<juce::XmlElement*> getGroups() const;
+
+    /** Returns each distinct sample file once, in the order they first appear. */
+    juce::Array<juce::File> getUniqueSampleFiles() const;
+
+    /** Returns the file a <sample> element currently points at. */
+    juce::File getSampleFile (const juce::XmlElement& sample) const;
+
+    /** Points a <sample> element at a different file. */
+    void setSampleFile (juce::XmlElement& sample, const juce::File& file);
+
+    //==============================================================================
+    /** Rewrites every sample path relative to a directory. This mirrors
+        DSPresetConverter::convertPathsToRelative(), but doesn't touch the disk.
+    */
+    void convertPathsToRelative (const juce::File& directory);
+
+    /** Rewrites every sample path to point at a file of the same name in the
+        given directory. This mirrors DSPresetConverter::convertPathsToDesiredDirectory().
+    */
+    void convertPathsToDesiredDirectory (const juce::String& desiredDirectory);
+
+    //==============================================================================
+    juce::XmlElement& getRootElement() noexcept             { return *root; }
+
+    juce::String toString() const;
+
+private:
+    std::unique_ptr<juce::XmlElement> root;
+    juce::File baseDirectory;
+
+    JUCE_DECLARE_NON_COPYABLE (PresetDocument)
+};
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    ProfileStats.cpp
+
+  ==============================================================================
+*/
+
+#include "ProfileStats.h"
+
+//==============================================================================
+void ProfileStats::add (const juce::String& counterName, juce::int64 amount)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = counters.find (counterName);
+    if(found == counters.end()) {
+        counters[counterName] = amount;
+        counterOrder.add (counterName);
+    } else {
+        found->second += amount;
+    }
+}
+
+juce::int64 ProfileStats::get (const juce::String& counterName) const
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = counters.find (counterName);
+    return found != counters.end() ? found->second : 0;
+}
+
+void ProfileStats::addStageTime (const juce::String& stageName, double milliseconds)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = stageTimes.find (stageName);
+    if(found == stageTimes.end()) {
+        stageTimes[stageName] = milliseconds;
+        stageOrder.add (stageName);
+    } else {
+        found->second += milliseconds;
+    }
+}
+
+void ProfileStats::print (std::ostream& out) const
+{
+    const juce::ScopedLock sl (lock);
+
+    for(auto& stageName : stageOrder)
+        out << "stage " << stageName << ": " << juce::String (stageTimes.at (stageName), 1) << " ms" << std::endl;
+
+    for(auto& counterName : counterOrder)
+        out << counterName << ": " << juce::String (counters.at (counterName)) << std::endl;
+}
+
+//==============================================================================
+ProfileStats::ScopedStage::ScopedStage (ProfileStats& s, const juce::String& name)
+    : stats (s), stageName (name), startTime (juce::Time::getMillisecondCounterHiRes())
+{
+}
+
+ProfileStats::ScopedStage::~ScopedStage()
+{
+    stats.addStageTime (stageName, juce::Time::getMillisecondCounterHiRes() - startTime);
+}
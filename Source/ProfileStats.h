@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    ProfileStats.h
+
+    Counters and stage timings gathered during a run, printed by --profile.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+/**
+    A thread-safe collection of named counters and stage timings.
+
+    One instance is shared by everything that runs during a single invocation,
+    so the numbers add up across every preset converted.
+*/
+class ProfileStats
+{
+public:
+    ProfileStats() = default;
+
+    /** Adds an amount to a named counter, creating it if needed. */
+    void add (const juce::String& counterName, juce::int64 amount = 1);
+
+    /** Returns the current value of a counter, or 0 if it has never been touched. */
+    juce::int64 get (const juce::String& counterName) const;
+
+    /** Adds some elapsed time to a named stage. */
+    void addStageTime (const juce::String& stageName, double milliseconds);
+
+    /** Writes all the stages and counters, in the order they first appeared. */
+    void print (std::ostream& out) const;
+
+    //==============================================================================
+    /** Times the enclosing scope and adds it to a stage when it goes out of scope. */
+    class ScopedStage
+    {
+    public:
+        ScopedStage (ProfileStats& stats, const juce::String& stageName);
+        ~ScopedStage();
+
+    private:
+        ProfileStats& stats;
+        juce::String stageName;
+        double startTime;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage)
+    };
+
+private:
+    juce::CriticalSection lock;
+    std::map<juce::String, juce::int64> counters;
+    std::map<juce::String, double> stageTimes;
+    juce::StringArray counterOrder, stageOrder;
+
+    JUCE_DECLARE_NON_COPYABLE (ProfileStats)
+};
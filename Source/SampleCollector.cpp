@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    SampleCollector.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleCollector.h"
+#include "ParallelFor.h"
+
+#if JUCE_LINUX
+ #include <fcntl.h>
+ #include <linux/fs.h>
+ #include <sys/ioctl.h>
+#elif JUCE_MAC
+ #include <sys/clonefile.h>
+#endif
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    bool cloneFile (const juce::File& source, const juce::File& target)
+    {
+       #if JUCE_LINUX
+        auto in = open (source.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+        if(in < 0)
+            return false;
+
+        auto out = open (target.getFullPathName().toRawUTF8(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if(out < 0) {
+            close (in);
+            return false;
+        }
+
+        auto cloned = ioctl (out, FICLONE, in) == 0;
+        close (in);
+        close (out);
+
+        if(! cloned)
+            unlink (target.getFullPathName().toRawUTF8());
+
+        return cloned;
+       #elif JUCE_MAC
+        return clonefile (source.getFullPathName().toRawUTF8(), target.getFullPathName().toRawUTF8(), 0) == 0;
+       #else
+        juce::ignoreUnused (source, target);
+        return false;
+       #endif
+    }
+
+    bool hardLinkFile (const juce::File& source, const juce::File& target)
+    {
+       #if JUCE_WINDOWS
+        juce::ignoreUnused (source, target);
+        return false;
+       #else
+        return link (source.getFullPathName().toRawUTF8(), target.getFullPathName().toRawUTF8()) == 0;
+       #endif
+    }
+
+    /** Lets the kernel do the copy, which avoids bouncing the data through user
+        space and becomes a server-side copy on NFS 4.2 and SMB3.
+    */
+    bool kernelCopyFile (const juce::File& source, const juce::File& target)
+    {
+       #if JUCE_LINUX
+        auto in = open (source.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+        if(in < 0)
+            return false;
+
+        struct stat info;
+        auto out = fstat (in, &info) == 0 ? open (target.getFullPathName().toRawUTF8(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644) : -1;
+        if(out < 0) {
+            close (in);
+            return false;
+        }
+
+        auto remaining = (juce::int64) info.st_size;
+        while(remaining > 0) {
+            auto copied = copy_file_range (in, nullptr, out, nullptr, (size_t) remaining, 0);
+            if(copied <= 0)
+                break;
+
+            remaining -= copied;
+        }
+
+        close (in);
+        close (out);
+
+        if(remaining > 0)
+            unlink (target.getFullPathName().toRawUTF8());
+
+        return remaining == 0;
+       #else
+        juce::ignoreUnused (source, target);
+        return false;
+       #endif
+    }
+}
+
+//==============================================================================
+SampleCollector::SampleCollector (ProfileStats& s, int maxOperationsPerDevice)
+    : stats (s), throttle (maxOperationsPerDevice)
+{
+}
+
+juce::Result SampleCollector::collect (const PresetDocument& preset, const juce::File& targetDirectory, juce::ThreadPool& pool)
+{
+    auto created = targetDirectory.createDirectory();
+    if(created.failed())
+        return juce::Result::fail ("Couldn't create \"" + targetDirectory.getFullPathName() + "\": " + created.getErrorMessage());
+
+    TargetClaims::Request request;
+    for(auto& source : preset.getUniqueSampleFiles())
+        request.add (targetDirectory.getChildFile (source.getFileName()), source);
+
+    auto claimed = claims.claim (request, "collected as");
+    if(claimed.failed())
+        return claimed;
+
+    auto targetDevice = DeviceThrottle::getDeviceFor (targetDirectory);
+    juce::StringArray errors;
+    juce::CriticalSection errorLock;
+
+    // Files claimed by another preset are being collected by it.
+    parallelFor (pool, request.size(), [&] (int i)
+    {
+        if(! request.isOwner (i))
+            return;
+
+        auto result = collectFile (request.getSource (i), request.getTarget (i), targetDevice);
+        request.finish (i, result);
+
+        if(result.failed()) {
+            const juce::ScopedLock sl (errorLock);
+            errors.add (result.getErrorMessage());
+        }
+    });
+
+    if(! errors.isEmpty())
+        return juce::Result::fail (errors.joinIntoString ("\n"));
+
+    return request.waitForOthers();
+}
+
+void SampleCollector::startNewRun()
+{
+    claims.clear();
+}
+
+juce::Result SampleCollector::collectFile (const juce::File& source, const juce::File& target, juce::uint64 targetDevice)
+{
+    if(source == target)
+        return juce::Result::ok();
+
+    if(target.existsAsFile() && target.getSize() == source.getSize()
+        && target.getLastModificationTime() >= source.getLastModificationTime()) {
+        stats.add ("collect.upToDate");
+        return juce::Result::ok();
+    }
+
+    DeviceThrottle::ScopedSlot slot (throttle, DeviceThrottle::getDeviceFor (source), targetDevice);
+
+    if(target.exists() && ! target.deleteFile())
+        return juce::Result::fail ("Couldn't replace \"" + target.getFullPathName() + "\".");
+
+    if(cloneFile (source, target))
+        stats.add ("collect.cloned");
+    else if(hardLinkFile (source, target))
+        stats.add ("collect.hardLinked");
+    else if(kernelCopyFile (source, target))
+        stats.add ("collect.kernelCopied");
+    else if(source.copyFileTo (target))
+        stats.add ("collect.copied");
+    else
+        return juce::Result::fail ("Couldn't copy \"" + source.getFullPathName() + "\" to \"" + target.getFullPathName() + "\".");
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    SampleCollector.h
+
+    Puts the samples a preset uses into the directory it expects them in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeviceThrottle.h"
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "TargetClaims.h"
+
+//==============================================================================
+/**
+    Materialises a preset's samples in a target directory, for use with the
+    [sample-directory] argument.
+
+    Each file is cloned (a reflink on Linux, clonefile on macOS) if the
+    filesystem supports it, otherwise hard linked, otherwise copied in the
+    kernel with copy_file_range, and only then copied through a buffer. Files
+    are collected in parallel, with at most a fixed number of operations per
+    device. Targets that are already up to date are left alone. A file that
+    another preset is collecting is waited for, and if it couldn't be
+    collected, this preset fails too.
+
+    Note that a hard-linked sample shares its data with the original, so
+    editing one in place changes both.
+*/
+class SampleCollector
+{
+public:
+    SampleCollector (ProfileStats& stats, int maxOperationsPerDevice);
+
+    /** Collects every sample the preset uses into targetDirectory. Fails if any
+        of them couldn't be collected, or if two different files would end up
+        with the same name.
+    */
+    juce::Result collect (const PresetDocument& preset, const juce::File& targetDirectory, juce::ThreadPool& pool);
+
+    /** Forgets which files were collected this run, so they're checked again
+        the next time they're collected.
+    */
+    void startNewRun();
+
+private:
+    juce::Result collectFile (const juce::File& source, const juce::File& target, juce::uint64 targetDevice);
+
+    ProfileStats& stats;
+    DeviceThrottle throttle;
+
+    TargetClaims claims;
+
+    JUCE_DECLARE_NON_COPYABLE (SampleCollector)
+};
@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    SampleConsolidation.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleConsolidation.h"
+#include "AudioFiles.h"
+#include "LoopPoints.h"
+#include "ParallelFor.h"
+#include <map>
+
+//==============================================================================
+namespace
+{
+    /** How much decoded audio to hold in memory while filling one file. */
+    constexpr juce::int64 readAheadBytes = 64 * 1024 * 1024;
+
+    struct Region
+    {
+        juce::File file;
+        SampleHeader header;
+        juce::int64 offset = 0;
+
+        juce::int64 getDecodedSize() const      { return header.lengthInSamples * header.numChannels * (juce::int64) sizeof (float); }
+    };
+
+    struct ConsolidatedFile
+    {
+        double sampleRate = 0;
+        int numChannels = 0, bitsPerSample = 16;
+        bool isFloatingPoint = false;
+
+        std::vector<Region> regions;
+        juce::int64 lengthInSamples = 0;
+    };
+
+    int getOutputBitDepth (const ConsolidatedFile& file)
+    {
+        if(file.isFloatingPoint || file.bitsPerSample > 24)
+            return 32;
+
+        return file.bitsPerSample > 16 ? 24 : 16;
+    }
+
+    juce::Result writeConsolidatedFile (const ConsolidatedFile& consolidated, const juce::File& target,
+                                        juce::ThreadPool& pool, ProfileStats& stats)
+    {
+        auto cantWrite = juce::Result::fail ("Couldn't write \"" + target.getFullPathName() + "\".");
+        juce::TemporaryFile temp (target);
+
+        {
+            juce::WavAudioFormat wav;
+            auto writer = createSampleWriter (temp.getFile(), wav, consolidated.sampleRate, consolidated.numChannels,
+                                              getOutputBitDepth (consolidated), consolidated.isFloatingPoint);
+            if(writer == nullptr)
+                return cantWrite;
+
+            auto& regions = consolidated.regions;
+            size_t next = 0;
+
+            while(next < regions.size()) {
+                // Take as many of the following samples as fit in the read-ahead budget.
+                auto first = next;
+                juce::int64 batchSize = 0;
+
+                while(next < regions.size() && (next == first || batchSize + regions[next].getDecodedSize() <= readAheadBytes))
+                    batchSize += regions[next++].getDecodedSize();
+
+                if(batchSize > readAheadBytes) {
+                    auto& region = regions[first];
+                    auto reader = createSampleReader (region.file);
+                    if(reader == nullptr)
+                        return juce::Result::fail ("Couldn't read \"" + region.file.getFullPathName() + "\".");
+
+                    if(! writer->writeFromAudioReader (*reader, 0, region.header.lengthInSamples))
+                        return cantWrite;
+
+                    stats.add ("consolidate.samplesStreamed");
+                    continue;
+                }
+
+                std::vector<juce::AudioBuffer<float>> buffers (next - first);
+                std::vector<char> wasRead (next - first);
+
+                parallelFor (pool, (int) buffers.size(), [&] (int i)
+                {
+                    auto& region = regions[first + (size_t) i];
+                    auto reader = createSampleReader (region.file);
+                    if(reader == nullptr)
+                        return;
+
+                    auto& buffer = buffers[(size_t) i];
+                    buffer.setSize (consolidated.numChannels, (int) region.header.lengthInSamples);
+                    wasRead[(size_t) i] = reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+                });
+
+                for(size_t i = 0; i < buffers.size(); ++i) {
+                    if(! wasRead[i])
+                        return juce::Result::fail ("Couldn't read \"" + regions[first + i].file.getFullPathName() + "\".");
+
+                    if(! writer->writeFromAudioSampleBuffer (buffers[i], 0, buffers[i].getNumSamples()))
+                        return cantWrite;
+                }
+            }
+        }
+
+        if(! temp.overwriteTargetFileWithTemporary())
+            return cantWrite;
+
+        stats.add ("consolidate.filesWritten");
+        stats.add ("consolidate.samplesConsolidated", (juce::int64) consolidated.regions.size());
+        return juce::Result::ok();
+    }
+
+    void pointAtRegion (PresetDocument& preset, juce::XmlElement& sample, const Region& region, const juce::File& consolidatedFile)
+    {
+        auto& header = region.header;
+        auto offset = region.offset;
+
+        auto start = (juce::int64) sample.getDoubleAttribute ("start", 0);
+        auto end = (juce::int64) sample.getDoubleAttribute ("end", (double) header.lengthInSamples);
+        sample.setAttribute ("start", juce::String (offset + start));
+        sample.setAttribute ("end", juce::String (offset + end));
+
+        writeEmbeddedLoopAttributes (sample, header, offset);
+
+        preset.setSampleFile (sample, consolidatedFile);
+    }
+}
+
+//==============================================================================
+juce::Result consolidateSamples (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                                 juce::ThreadPool& pool, ConsolidationScope scope,
+                                 const juce::File& directory, const juce::String& fileStem)
+{
+    if(scope == ConsolidationScope::none)
+        return juce::Result::ok();
+
+    auto created = directory.createDirectory();
+    if(created.failed())
+        return juce::Result::fail ("Couldn't create \"" + directory.getFullPathName() + "\": " + created.getErrorMessage());
+
+    juce::Array<juce::XmlElement*> units;
+    if(scope == ConsolidationScope::group)
+        units = preset.getGroups();
+    else
+        units.add (&preset.getRootElement());
+
+    for(int unit = 0; unit < units.size(); ++unit) {
+        auto samples = PresetDocument::getSamplesIn (*units[unit]);
+
+        std::vector<ConsolidatedFile> files;
+        std::map<juce::String, std::pair<size_t, size_t>> regionsByPath;    // file index, region index
+
+        for(auto* sample : samples) {
+            auto file = preset.getSampleFile (*sample);
+            auto path = file.getFullPathName();
+            if(regionsByPath.count (path) > 0)
+                continue;
+
+            auto header = headers.getHeader (file);
+            if(! header.isValid || header.lengthInSamples <= 0) {
+                stats.add ("consolidate.samplesLeftSeparate");
+                continue;
+            }
+
+            auto matchingFormat = std::find_if (files.begin(), files.end(), [&] (const ConsolidatedFile& f)
+            {
+                return f.sampleRate == header.sampleRate && f.numChannels == header.numChannels;
+            });
+
+            if(matchingFormat == files.end()) {
+                files.emplace_back();
+                matchingFormat = std::prev (files.end());
+                matchingFormat->sampleRate = header.sampleRate;
+                matchingFormat->numChannels = header.numChannels;
+            }
+
+            auto& consolidated = *matchingFormat;
+            consolidated.bitsPerSample = juce::jmax (consolidated.bitsPerSample, header.bitsPerSample);
+            consolidated.isFloatingPoint = consolidated.isFloatingPoint || header.isFloatingPoint;
+            consolidated.regions.push_back ({ file, header, consolidated.lengthInSamples });
+            consolidated.lengthInSamples += header.lengthInSamples;
+
+            regionsByPath[path] = { (size_t) std::distance (files.begin(), matchingFormat), consolidated.regions.size() - 1 };
+        }
+
+        juce::Array<juce::File> targets;
+
+        for(size_t i = 0; i < files.size(); ++i) {
+            auto name = fileStem;
+            if(scope == ConsolidationScope::group)
+                name << "-group" << (unit + 1);
+            if(i > 0)
+                name << "-" << (int) (i + 1);
+
+            targets.add (directory.getChildFile (name + ".wav"));
+
+            auto written = writeConsolidatedFile (files[i], targets.getLast(), pool, stats);
+            if(written.failed())
+                return written;
+        }
+
+        for(auto* sample : samples) {
+            auto found = regionsByPath.find (preset.getSampleFile (*sample).getFullPathName());
+            if(found == regionsByPath.end())
+                continue;
+
+            auto [fileIndex, regionIndex] = found->second;
+            pointAtRegion (preset, *sample, files[fileIndex].regions[regionIndex], targets[(int) fileIndex]);
+        }
+    }
+
+    return juce::Result::ok();
+}
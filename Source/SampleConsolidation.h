@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    SampleConsolidation.h
+
+    Packs a preset's samples into a few large WAV files.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+
+//==============================================================================
+/** What each consolidated file holds. */
+enum class ConsolidationScope
+{
+    none,
+    preset,     // every sample in the preset
+    group       // the samples of one <group>
+};
+
+/**
+    Replaces the sample files a preset uses with one WAV file per preset or per
+    group, so that Decent Sampler opens a handful of files instead of thousands.
+
+    Each zone is pointed at its consolidated file and given start and end
+    attributes that select its region (end is one past the region's last
+    frame). Its loop points are moved by the same offset, and any loop or root
+    note that was only stored in the original file's chunks is written out as
+    attributes. Only samples with the same rate and channel count can share a
+    file, so a preset that mixes them gets one file per format. Samples whose
+    headers couldn't be read are left where they are.
+
+    Files are named "<fileStem>.wav", then "<fileStem>-2.wav" and so on, or
+    "<fileStem>-group1.wav" etc. when consolidating per group. The sources are
+    decoded in parallel, a bounded amount at a time; samples too large for
+    that are streamed straight into the output.
+*/
+juce::Result consolidateSamples (PresetDocument& preset, SampleHeaderCache& headers, ProfileStats& stats,
+                                 juce::ThreadPool& pool, ConsolidationScope scope,
+                                 const juce::File& directory, const juce::String& fileStem);
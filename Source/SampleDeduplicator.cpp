@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    SampleDeduplicator.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleDeduplicator.h"
+#include "FastHash.h"
+#include "OpenFileLimit.h"
+#include "ParallelFor.h"
+#include <set>
+
+//==============================================================================
+SampleDeduplicator::SampleDeduplicator (ProfileStats& s)
+    : stats (s)
+{
+}
+
+juce::int64 SampleDeduplicator::getBytesSaved() const
+{
+    const juce::ScopedLock sl (lock);
+    return bytesSaved;
+}
+
+void SampleDeduplicator::startNewRun()
+{
+    const juce::ScopedLock sl (lock);
+    seenFiles.clear();
+    pathsBySize.clear();
+    canonicalFiles.clear();
+    bytesSaved = 0;
+}
+
+void SampleDeduplicator::deduplicate (PresetDocument& preset, SampleHeaderCache& headers, juce::ThreadPool& pool)
+{
+    auto files = preset.getUniqueSampleFiles();
+    std::vector<SeenFile*> filesToHash;
+
+    std::vector<juce::int64> sizes;
+    for(auto& file : files)
+        sizes.push_back (headers.getFileSize (file));
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        for(int i = 0; i < files.size(); ++i) {
+            auto& file = files.getReference (i);
+            auto path = file.getFullPathName();
+            auto size = sizes[(size_t) i];
+            if(size <= 0 || seenFiles.count (path) > 0)
+                continue;
+
+            auto& seen = seenFiles[path];
+            seen.file = file;
+            seen.size = size;
+            pathsBySize[size].add (path);
+        }
+
+        // Only files that share their size with another one can be duplicates,
+        // and this is usually enough to rule out almost everything.
+        std::set<SeenFile*> queued;
+
+        for(auto& file : files) {
+            auto found = seenFiles.find (file.getFullPathName());
+            if(found == seenFiles.end())
+                continue;
+
+            auto& sameSize = pathsBySize[found->second.size];
+            if(sameSize.size() < 2)
+                continue;
+
+            for(auto& path : sameSize) {
+                auto* seen = &seenFiles[path];
+                if(! seen->isHashed && ! seen->couldNotBeRead && queued.insert (seen).second)
+                    filesToHash.push_back (seen);
+            }
+        }
+    }
+
+    std::vector<juce::uint64> hashes (filesToHash.size());
+    std::vector<char> wasRead (filesToHash.size());
+    std::vector<juce::File> fileNames;
+
+    for(auto* seen : filesToHash)
+        fileNames.push_back (seen->file);
+
+    {
+        ProfileStats::ScopedStage stage (stats, "dedup.hashing");
+
+        parallelFor (pool, (int) filesToHash.size(), [&] (int i)
+        {
+            wasRead[(size_t) i] = FastHash::hashFile (fileNames[(size_t) i], hashes[(size_t) i]);
+        });
+    }
+
+    // Files that match a canonical file's size and hash, paired with it.
+    std::vector<std::pair<SeenFile*, juce::File>> candidates;
+
+    {
+        const juce::ScopedLock sl (lock);
+        std::vector<SeenFile*> newlyHashed;
+
+        for(size_t i = 0; i < filesToHash.size(); ++i) {
+            auto* seen = filesToHash[i];
+            if(seen->isHashed || seen->couldNotBeRead)
+                continue;   // another preset got there first
+
+            if(wasRead[i]) {
+                seen->isHashed = true;
+                seen->hash = hashes[i];
+                newlyHashed.push_back (seen);
+                stats.add ("dedup.filesHashed");
+                stats.add ("dedup.bytesHashed", seen->size);
+            } else {
+                seen->couldNotBeRead = true;
+            }
+        }
+
+        registerCanonicalFiles (newlyHashed);
+
+        // This includes files another preset is still comparing, which are
+        // simply compared again rather than waited for.
+        for(auto& file : files) {
+            auto found = seenFiles.find (file.getFullPathName());
+            if(found == seenFiles.end() || ! found->second.isHashed || found->second.isVerified)
+                continue;
+
+            auto& seen = found->second;
+            candidates.push_back ({ &seen, canonicalFiles.at (Key { seen.size, seen.hash }) });
+        }
+    }
+
+    std::vector<char> isIdentical (candidates.size());
+
+    {
+        ProfileStats::ScopedStage stage (stats, "dedup.comparing");
+
+        parallelFor (pool, (int) candidates.size(), [&] (int i)
+        {
+            auto& candidate = candidates[(size_t) i];
+            isIdentical[(size_t) i] = haveSameContents (candidate.first->file, candidate.second);
+        });
+    }
+
+    const juce::ScopedLock sl (lock);
+
+    for(size_t i = 0; i < candidates.size(); ++i) {
+        auto* seen = candidates[i].first;
+        if(seen->isVerified)
+            continue;   // another preset got there first
+
+        seen->isVerified = true;
+
+        if(! isIdentical[i]) {
+            stats.add ("dedup.hashCollisions");
+            continue;
+        }
+
+        seen->duplicateOf = candidates[i].second;
+        bytesSaved += seen->size;
+        stats.add ("dedup.duplicateFiles");
+        stats.add ("dedup.bytesSaved", seen->size);
+    }
+
+    for(auto* sample : preset.getSamples()) {
+        auto seen = seenFiles.find (preset.getSampleFile (*sample).getFullPathName());
+        if(seen == seenFiles.end() || seen->second.duplicateOf == juce::File())
+            continue;
+
+        preset.setSampleFile (*sample, seen->second.duplicateOf);
+        stats.add ("dedup.samplesRedirected");
+    }
+}
+
+void SampleDeduplicator::registerCanonicalFiles (std::vector<SeenFile*> files)
+{
+    // A canonical file never changes once registered, so presets that have
+    // already been written never need to change. Within one preset, sorting
+    // makes the choice independent of the order the hashes came back in.
+    std::sort (files.begin(), files.end(),
+               [] (const SeenFile* a, const SeenFile* b) { return a->file.getFullPathName() < b->file.getFullPathName(); });
+
+    for(auto* seen : files)
+        if(canonicalFiles.emplace (Key { seen->size, seen->hash }, seen->file).second)
+            seen->isVerified = true;
+}
+
+bool SampleDeduplicator::haveSameContents (const juce::File& a, const juce::File& b)
+{
+    // Counted as one file, as the second is opened while the first is held.
+    const OpenFileLimit::ScopedFile openFile;
+    juce::FileInputStream streamA (a), streamB (b);
+    if(! streamA.openedOk() || ! streamB.openedOk() || streamA.getTotalLength() != streamB.getTotalLength())
+        return false;
+
+    constexpr int blockSize = 1 << 20;
+    juce::HeapBlock<char> blockA (blockSize), blockB (blockSize);
+
+    for(;;) {
+        auto numReadA = streamA.read (blockA.get(), blockSize);
+        auto numReadB = streamB.read (blockB.get(), blockSize);
+        if(numReadA != numReadB || numReadA < 0)
+            return false;
+        if(numReadA == 0)
+            return true;
+
+        if(memcmp (blockA.get(), blockB.get(), (size_t) numReadA) != 0)
+            return false;
+    }
+}
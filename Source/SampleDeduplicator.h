@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    SampleDeduplicator.h
+
+    Points samples with identical audio at a single copy.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+#include <map>
+
+//==============================================================================
+/**
+    Finds sample files with byte-identical contents and rewrites each preset's
+    <sample> elements to use one canonical copy.
+
+    Only files whose size matches another referenced file are hashed, and that
+    hashing runs in parallel on the pool. Files whose size and 64-bit FastHash
+    match are then compared byte for byte before any zone is pointed at a
+    different file.
+
+    The first copy registered in a run becomes canonical and stays canonical,
+    so presets converted later in the same run share the samples of earlier
+    ones and presets already written never go stale. Among copies registered
+    by the same preset, the one with the smallest path wins. Which copy ends
+    up canonical therefore depends on the order presets are converted in, so
+    deduplicated presets aren't guaranteed to come out the same from run to
+    run, or from a sharded run. All methods are thread-safe.
+*/
+class SampleDeduplicator
+{
+public:
+    explicit SampleDeduplicator (ProfileStats& stats);
+
+    /** Rewrites any <sample> whose file duplicates another one seen in the run. */
+    void deduplicate (PresetDocument& preset, SampleHeaderCache& headers, juce::ThreadPool& pool);
+
+    /** Returns the total size of the duplicate files that are no longer referenced. */
+    juce::int64 getBytesSaved() const;
+
+    /** Forgets every file seen so far, so that the next preset starts a new run. */
+    void startNewRun();
+
+private:
+    //==============================================================================
+    struct Key
+    {
+        juce::int64 size;
+        juce::uint64 hash;
+
+        bool operator< (const Key& other) const noexcept    { return size != other.size ? size < other.size : hash < other.hash; }
+    };
+
+    struct SeenFile
+    {
+        juce::File file;
+        juce::int64 size = 0;
+        bool isHashed = false, couldNotBeRead = false;
+        juce::uint64 hash = 0;
+
+        /** Set once the file is known to be canonical, or to be a copy of the
+            canonical file, or to only share its hash with it.
+        */
+        bool isVerified = false;
+        juce::File duplicateOf;
+    };
+
+    void registerCanonicalFiles (std::vector<SeenFile*> files);
+    static bool haveSameContents (const juce::File& a, const juce::File& b);
+
+    ProfileStats& stats;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, SeenFile> seenFiles;
+    std::map<juce::int64, juce::Array<juce::String>> pathsBySize;
+    std::map<Key, juce::File> canonicalFiles;
+    juce::int64 bytesSaved = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (SampleDeduplicator)
+};
@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    SampleHeader.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleHeader.h"
+#include "AudioFiles.h"
+#include "OpenFileLimit.h"
+
+//==============================================================================
+namespace
+{
+    // The largest fmt/COMM/smpl/MARK/INST chunk we're prepared to read into memory.
+    constexpr juce::uint64 maxChunkBytesToRead = 65536;
+
+    bool hasId (const char* id, const char* expected)
+    {
+        return memcmp (id, expected, 4) == 0;
+    }
+
+    bool readChunk (juce::InputStream& stream, juce::uint64 size, juce::MemoryBlock& block)
+    {
+        block.setSize ((size_t) juce::jmin (size, maxChunkBytesToRead), true);
+        return stream.read (block.getData(), (int) block.getSize()) == (int) block.getSize();
+    }
+
+    /** Converts the 80-bit IEEE extended float that AIFF uses for sample rates. */
+    double readExtended (const juce::uint8* bytes)
+    {
+        auto exponent = ((bytes[0] & 0x7f) << 8) | bytes[1];
+        juce::uint64 mantissa = ((juce::uint64) juce::ByteOrder::bigEndianInt (bytes + 2) << 32)
+                              | juce::ByteOrder::bigEndianInt (bytes + 6);
+
+        if(exponent == 0 && mantissa == 0)
+            return 0.0;
+
+        auto value = std::ldexp ((double) mantissa, exponent - 16383 - 63);
+        return (bytes[0] & 0x80) != 0 ? -value : value;
+    }
+
+    //==============================================================================
+    SampleHeader readWav (juce::InputStream& stream, bool isRF64)
+    {
+        SampleHeader header;
+        header.format = "WAV";
+
+        const auto totalLength = (juce::uint64) stream.getTotalLength();
+        juce::uint64 rf64DataSize = 0, dataSize = 0;
+        int blockAlign = 0;
+        bool hasFormat = false, hasData = false;
+        juce::MemoryBlock chunk;
+
+        while((juce::uint64) stream.getPosition() + 8 <= totalLength) {
+            char id[4];
+            juce::uint8 sizeBytes[4];
+            if(stream.read (id, 4) != 4 || stream.read (sizeBytes, 4) != 4)
+                break;
+
+            juce::uint64 size = juce::ByteOrder::littleEndianInt (sizeBytes);
+            const auto chunkStart = (juce::uint64) stream.getPosition();
+
+            if(hasId (id, "ds64")) {
+                if(size >= 24 && readChunk (stream, size, chunk))
+                    rf64DataSize = juce::ByteOrder::littleEndianInt64 (static_cast<const juce::uint8*> (chunk.getData()) + 8);
+            } else if(hasId (id, "fmt ")) {
+                if(size >= 16 && readChunk (stream, size, chunk)) {
+                    auto* bytes = static_cast<const juce::uint8*> (chunk.getData());
+                    auto formatTag = juce::ByteOrder::littleEndianShort (bytes);
+
+                    // WAVE_FORMAT_EXTENSIBLE keeps the real format at the start of the sub-format GUID.
+                    if(formatTag == 0xfffe && size >= 40)
+                        formatTag = juce::ByteOrder::littleEndianShort (bytes + 24);
+
+                    header.numChannels = juce::ByteOrder::littleEndianShort (bytes + 2);
+                    header.sampleRate = juce::ByteOrder::littleEndianInt (bytes + 4);
+                    blockAlign = juce::ByteOrder::littleEndianShort (bytes + 12);
+                    header.bitsPerSample = juce::ByteOrder::littleEndianShort (bytes + 14);
+                    header.isFloatingPoint = formatTag == 3;
+                    hasFormat = formatTag == 1 || formatTag == 3;
+                }
+            } else if(hasId (id, "data")) {
+                if(isRF64 && size == 0xffffffff)
+                    size = rf64DataSize;
+
+                // Some writers leave a bogus size behind when they're interrupted.
+                size = juce::jmin (size, totalLength - chunkStart);
+                dataSize = size;
+                hasData = true;
+            } else if(hasId (id, "smpl")) {
+                if(size >= 36 && readChunk (stream, size, chunk)) {
+                    auto* bytes = static_cast<const juce::uint8*> (chunk.getData());
+                    header.rootNote = (int) juce::ByteOrder::littleEndianInt (bytes + 12);
+
+                    auto numLoops = juce::ByteOrder::littleEndianInt (bytes + 28);
+                    if(numLoops > 0 && chunk.getSize() >= 36 + 24) {
+                        header.loopStart = juce::ByteOrder::littleEndianInt (bytes + 36 + 8);
+                        header.loopEnd = juce::ByteOrder::littleEndianInt (bytes + 36 + 12);
+                    }
+                }
+            }
+
+            // Chunks are padded to an even length.
+            if(! stream.setPosition ((juce::int64) (chunkStart + size + (size & 1))))
+                break;
+        }
+
+        if(hasFormat && hasData && blockAlign > 0) {
+            header.lengthInSamples = (juce::int64) (dataSize / (juce::uint64) blockAlign);
+            header.isValid = header.sampleRate > 0;
+        }
+
+        return header;
+    }
+
+    //==============================================================================
+    SampleHeader readAiff (juce::InputStream& stream, bool isAifc)
+    {
+        SampleHeader header;
+        header.format = "AIFF";
+
+        const auto totalLength = (juce::uint64) stream.getTotalLength();
+        std::map<int, juce::int64> markerPositions;
+        int loopMode = 0, loopStartMarker = -1, loopEndMarker = -1;
+        bool hasFormat = false;
+        juce::MemoryBlock chunk;
+
+        while((juce::uint64) stream.getPosition() + 8 <= totalLength) {
+            char id[4];
+            juce::uint8 sizeBytes[4];
+            if(stream.read (id, 4) != 4 || stream.read (sizeBytes, 4) != 4)
+                break;
+
+            const juce::uint64 size = juce::ByteOrder::bigEndianInt (sizeBytes);
+            const auto chunkStart = (juce::uint64) stream.getPosition();
+
+            if(hasId (id, "COMM")) {
+                if(size >= 18 && readChunk (stream, size, chunk)) {
+                    auto* bytes = static_cast<const juce::uint8*> (chunk.getData());
+                    header.numChannels = juce::ByteOrder::bigEndianShort (bytes);
+                    header.lengthInSamples = juce::ByteOrder::bigEndianInt (bytes + 2);
+                    header.bitsPerSample = juce::ByteOrder::bigEndianShort (bytes + 6);
+                    header.sampleRate = readExtended (bytes + 8);
+                    hasFormat = true;
+
+                    if(isAifc && size >= 22) {
+                        auto* compression = reinterpret_cast<const char*> (bytes + 18);
+                        header.isFloatingPoint = hasId (compression, "fl32") || hasId (compression, "FL32")
+                                              || hasId (compression, "fl64") || hasId (compression, "FL64");
+                        hasFormat = header.isFloatingPoint || hasId (compression, "NONE") || hasId (compression, "sowt")
+                                 || hasId (compression, "twos") || hasId (compression, "raw ");
+                    }
+                }
+            } else if(hasId (id, "MARK")) {
+                if(size >= 2 && readChunk (stream, size, chunk)) {
+                    auto* bytes = static_cast<const juce::uint8*> (chunk.getData());
+                    auto numMarkers = (int) juce::ByteOrder::bigEndianShort (bytes);
+                    size_t offset = 2;
+
+                    for(int i = 0; i < numMarkers && offset + 7 <= chunk.getSize(); ++i) {
+                        auto markerId = (int) juce::ByteOrder::bigEndianShort (bytes + offset);
+                        markerPositions[markerId] = juce::ByteOrder::bigEndianInt (bytes + offset + 2);
+
+                        // The marker's name is a Pascal string padded to an even total length.
+                        auto nameLength = (size_t) bytes[offset + 6] + 1;
+                        offset += 6 + nameLength + (nameLength & 1);
+                    }
+                }
+            } else if(hasId (id, "INST")) {
+                if(size >= 20 && readChunk (stream, size, chunk)) {
+                    auto* bytes = static_cast<const juce::uint8*> (chunk.getData());
+                    header.rootNote = bytes[0];
+                    loopMode = juce::ByteOrder::bigEndianShort (bytes + 8);
+                    loopStartMarker = juce::ByteOrder::bigEndianShort (bytes + 10);
+                    loopEndMarker = juce::ByteOrder::bigEndianShort (bytes + 12);
+                }
+            }
+
+            if(! stream.setPosition ((juce::int64) (chunkStart + size + (size & 1))))
+                break;
+        }
+
+        auto loopStart = markerPositions.find (loopStartMarker);
+        auto loopEnd = markerPositions.find (loopEndMarker);
+        if(loopMode != 0 && loopStart != markerPositions.end() && loopEnd != markerPositions.end()
+            && loopEnd->second > loopStart->second) {
+            // AIFF's end marker sits just after the last sample of the loop.
+            header.loopStart = loopStart->second;
+            header.loopEnd = loopEnd->second - 1;
+        }
+
+        header.isValid = hasFormat && header.sampleRate > 0;
+        return header;
+    }
+}
+
+//==============================================================================
+SampleHeader SampleHeader::readFromFile (const juce::File& file)
+{
+    const OpenFileLimit::ScopedFile openFile;
+    juce::FileInputStream stream (file);
+    if(! stream.openedOk())
+        return {};
+
+    char riff[12];
+    if(stream.read (riff, 12) != 12)
+        return {};
+
+    if((hasId (riff, "RIFF") || hasId (riff, "RF64")) && hasId (riff + 8, "WAVE"))
+        return readWav (stream, hasId (riff, "RF64"));
+
+    if(hasId (riff, "FORM") && (hasId (riff + 8, "AIFF") || hasId (riff + 8, "AIFC")))
+        return readAiff (stream, hasId (riff + 8, "AIFC"));
+
+    return {};
+}
+
+SampleHeader SampleHeader::readUsingAudioFormats (const juce::File& file)
+{
+    auto reader = createSampleReader (file);
+    if(reader == nullptr)
+        return {};
+
+    SampleHeader header;
+    header.isValid = true;
+    header.format = reader->getFormatName();
+    header.sampleRate = reader->sampleRate;
+    header.numChannels = (int) reader->numChannels;
+    header.bitsPerSample = (int) reader->bitsPerSample;
+    header.isFloatingPoint = reader->usesFloatingPointData;
+    header.lengthInSamples = reader->lengthInSamples;
+    return header;
+}
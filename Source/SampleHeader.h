@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    SampleHeader.h
+
+    What we need to know about a sample file, read from its header chunks
+    without decoding any audio.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** The format, length and embedded loop of a sample file. */
+struct SampleHeader
+{
+    bool isValid = false;
+
+    juce::String format;                // "WAV", "AIFF", or the name of the JUCE format that read it
+    double sampleRate = 0;
+    int numChannels = 0;
+    int bitsPerSample = 0;
+    bool isFloatingPoint = false;
+    juce::int64 lengthInSamples = 0;
+
+    /** From a WAV smpl chunk or an AIFF INST chunk, or -1 if there isn't one. */
+    int rootNote = -1;
+
+    /** The first loop in the file, or -1 if there isn't one. Both ends are inclusive. */
+    juce::int64 loopStart = -1, loopEnd = -1;
+
+    /** Reads the header chunks of a WAV, RF64 or AIFF/AIFC file. Only the chunk
+        headers and the small chunks we need are read; audio data is skipped.
+        Returns an invalid header for any other kind of file.
+    */
+    static SampleHeader readFromFile (const juce::File& file);
+
+    /** Reads a header using whichever JUCE audio format can open the file. This
+        creates a full AudioFormatReader, so it's only used for formats that
+        readFromFile() doesn't understand.
+    */
+    static SampleHeader readUsingAudioFormats (const juce::File& file);
+};
@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    SampleHeaderCache.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleHeaderCache.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <vector>
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    const char* const cacheFileIdentifier = "EXS2DS sample header cache 3";
+    constexpr int numFieldsPerLine = 13;
+
+    /** Entries that no run has used for this long are dropped when saving. */
+    constexpr int maxUnusedDays = 90;
+
+    /** Beyond this, the least recently used entries are dropped when saving. */
+    constexpr size_t maxEntries = 1000000;
+
+    int getToday()
+    {
+        return (int) (juce::Time::currentTimeMillis() / (24 * 60 * 60 * 1000));
+    }
+}
+
+//==============================================================================
+SampleHeaderCache::SampleHeaderCache (ProfileStats& s, DeviceThrottle& t, const juce::File& file)
+    : stats (s), metadataThrottle (t), cacheFile (file)
+{
+    load();
+}
+
+SampleHeaderCache::~SampleHeaderCache()
+{
+    save();
+}
+
+juce::File SampleHeaderCache::getDefaultCacheFile()
+{
+   #if JUCE_MAC
+    return juce::File::getSpecialLocation (juce::File::userHomeDirectory).getChildFile ("Library/Caches/EXS2DS/SampleHeaders.tsv");
+   #elif JUCE_WINDOWS
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory).getChildFile ("EXS2DS/SampleHeaders.tsv");
+   #else
+    return juce::File::getSpecialLocation (juce::File::userHomeDirectory).getChildFile (".cache/EXS2DS/SampleHeaders.tsv");
+   #endif
+}
+
+//==============================================================================
+void SampleHeaderCache::probe (juce::ThreadPool& pool, const juce::Array<juce::File>& files)
+{
+    parallelFor (pool, files.size(), [&] (int i) { getHeader (files.getReference (i)); });
+}
+
+SampleHeader SampleHeaderCache::getHeader (const juce::File& file)
+{
+    auto key = file.getFullPathName();
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto existing = entries.find (key);
+        if(existing != entries.end() && existing->second.checkedThisRun)
+            return existing->second.header;
+    }
+
+    Entry entry;
+    entry.checkedThisRun = true;
+    entry.lastUsedDay = getToday();
+
+    bool exists;
+    {
+        auto device = metadataThrottle.getDeviceForDirectory (file.getParentDirectory(), stats);
+        const DeviceThrottle::ScopedSlot slot (metadataThrottle, device, device);
+
+        stats.add ("metadata.stats");
+        exists = getFileStamp (file, entry.size, entry.modificationTime);
+    }
+
+    if(exists) {
+        {
+            const juce::ScopedLock sl (lock);
+            auto existing = entries.find (key);
+            if(existing != entries.end() && existing->second.size == entry.size
+                && existing->second.modificationTime == entry.modificationTime) {
+                existing->second.checkedThisRun = true;
+                stats.add ("headers.cacheHits");
+
+                // Only rewritten once a day for the sake of this.
+                if(existing->second.lastUsedDay != entry.lastUsedDay) {
+                    existing->second.lastUsedDay = entry.lastUsedDay;
+                    hasChanged = true;
+                }
+
+                return existing->second.header;
+            }
+        }
+
+        entry.header = SampleHeader::readFromFile (file);
+        stats.add ("headers.read");
+
+        if(! entry.header.isValid) {
+            entry.header = SampleHeader::readUsingAudioFormats (file);
+            stats.add ("headers.readerFallbacks");
+        }
+    }
+
+    const juce::ScopedLock sl (lock);
+    entries[key] = entry;
+    hasChanged = true;
+    return entry.header;
+}
+
+juce::int64 SampleHeaderCache::getFileSize (const juce::File& file)
+{
+    getHeader (file);
+
+    const juce::ScopedLock sl (lock);
+    auto existing = entries.find (file.getFullPathName());
+    return existing != entries.end() ? existing->second.size : 0;
+}
+
+void SampleHeaderCache::startNewRun()
+{
+    const juce::ScopedLock sl (lock);
+
+    for(auto& entry : entries)
+        entry.second.checkedThisRun = false;
+}
+
+//==============================================================================
+void SampleHeaderCache::load()
+{
+    if(cacheFile == juce::File() || ! cacheFile.existsAsFile())
+        return;
+
+    juce::StringArray lines;
+    cacheFile.readLines (lines);
+
+    if(lines.isEmpty() || lines[0] != cacheFileIdentifier)
+        return;
+
+    for(int i = 1; i < lines.size(); ++i) {
+        auto fields = juce::StringArray::fromTokens (lines[i], "\t", "");
+        if(fields.size() != numFieldsPerLine)
+            continue;
+
+        Entry entry;
+        entry.size = fields[1].getLargeIntValue();
+        entry.modificationTime = fields[2].getLargeIntValue();
+
+        auto& header = entry.header;
+        header.isValid = true;
+        header.format = fields[3];
+        header.sampleRate = fields[4].getDoubleValue();
+        header.numChannels = fields[5].getIntValue();
+        header.bitsPerSample = fields[6].getIntValue();
+        header.isFloatingPoint = fields[7].getIntValue() != 0;
+        header.lengthInSamples = fields[8].getLargeIntValue();
+        header.rootNote = fields[9].getIntValue();
+        header.loopStart = fields[10].getLargeIntValue();
+        header.loopEnd = fields[11].getLargeIntValue();
+        entry.lastUsedDay = fields[12].getIntValue();
+
+        entries[fields[0]] = entry;
+    }
+}
+
+bool SampleHeaderCache::save()
+{
+    const juce::ScopedLock sl (lock);
+
+    if(cacheFile == juce::File() || ! hasChanged)
+        return true;
+
+    prune();
+
+    juce::MemoryOutputStream out;
+    out << cacheFileIdentifier << "\n";
+
+    for(auto& [path, entry] : entries) {
+        auto& header = entry.header;
+        if(! header.isValid || path.containsAnyOf ("\t\r\n"))
+            continue;
+
+        out << path << "\t" << entry.size << "\t" << entry.modificationTime << "\t"
+            << header.format << "\t" << juce::String (header.sampleRate, 3) << "\t"
+            << header.numChannels << "\t" << header.bitsPerSample << "\t" << (header.isFloatingPoint ? 1 : 0) << "\t"
+            << header.lengthInSamples << "\t" << header.rootNote << "\t"
+            << header.loopStart << "\t" << header.loopEnd << "\t" << entry.lastUsedDay << "\n";
+    }
+
+    cacheFile.getParentDirectory().createDirectory();
+
+    juce::TemporaryFile temp (cacheFile);
+    if(! temp.getFile().replaceWithData (out.getData(), out.getDataSize()) || ! temp.overwriteTargetFileWithTemporary())
+        return false;
+
+    hasChanged = false;
+    return true;
+}
+
+void SampleHeaderCache::prune()
+{
+    const auto oldestDayKept = getToday() - maxUnusedDays;
+    const auto numEntries = entries.size();
+
+    for(auto i = entries.begin(); i != entries.end();) {
+        if(i->second.lastUsedDay < oldestDayKept)
+            i = entries.erase (i);
+        else
+            ++i;
+    }
+
+    if(entries.size() > maxEntries) {
+        std::vector<std::map<juce::String, Entry>::iterator> byLastUse;
+        for(auto i = entries.begin(); i != entries.end(); ++i)
+            byLastUse.push_back (i);
+
+        auto numToDrop = byLastUse.size() - maxEntries;
+        std::nth_element (byLastUse.begin(), byLastUse.begin() + (std::ptrdiff_t) numToDrop, byLastUse.end(),
+                          [] (auto a, auto b) { return a->second.lastUsedDay < b->second.lastUsedDay; });
+
+        for(size_t i = 0; i < numToDrop; ++i)
+            entries.erase (byLastUse[i]);
+    }
+
+    stats.add ("headers.pruned", (juce::int64) (numEntries - entries.size()));
+}
+
+bool SampleHeaderCache::getFileStamp (const juce::File& file, juce::int64& size, juce::int64& modificationTime)
+{
+   #if JUCE_WINDOWS
+    if(! file.existsAsFile())
+        return false;
+
+    size = file.getSize();
+    modificationTime = file.getLastModificationTime().toMilliseconds() * 1000000;
+   #else
+    // One stat instead of the two that File::getSize() and getLastModificationTime() would make.
+    struct stat info;
+    if(stat (file.getFullPathName().toRawUTF8(), &info) != 0 || ! S_ISREG (info.st_mode))
+        return false;
+
+    // In nanoseconds, so that a file rewritten within the same second as the
+    // last probe, as a sample editor or the transcoder might, is seen to change.
+    size = (juce::int64) info.st_size;
+   #if JUCE_MAC
+    modificationTime = (juce::int64) info.st_mtimespec.tv_sec * 1000000000 + (juce::int64) info.st_mtimespec.tv_nsec;
+   #else
+    modificationTime = (juce::int64) info.st_mtim.tv_sec * 1000000000 + (juce::int64) info.st_mtim.tv_nsec;
+   #endif
+   #endif
+
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    SampleHeaderCache.h
+
+    Probes sample headers in parallel and remembers them between runs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeviceThrottle.h"
+#include "ProfileStats.h"
+#include "SampleHeader.h"
+#include <map>
+
+//==============================================================================
+/**
+    Holds the SampleHeader of every sample a run has looked at.
+
+    Entries are keyed by path and are only trusted while the file's size and
+    modification time still match, so a cache file can be kept between runs:
+    re-converting a library whose samples haven't changed costs one stat per
+    sample instead of opening each one. Each file is checked at most once per
+    run. Those stat calls each take a slot from the metadata throttle for the
+    file's device.
+
+    Each entry remembers the last day a run used it. Saving drops entries that
+    haven't been used for 90 days, such as those of samples that were deleted
+    or moved, and keeps at most a million of the most recently used.
+
+    All methods are thread-safe.
+*/
+class SampleHeaderCache
+{
+public:
+    /** Creates a cache that is loaded from and saved to cacheFile. If cacheFile
+        is File(), nothing is kept between runs.
+    */
+    SampleHeaderCache (ProfileStats& stats, DeviceThrottle& metadataThrottle, const juce::File& cacheFile);
+
+    /** Saves the cache, if anything has changed. */
+    ~SampleHeaderCache();
+
+    /** Makes sure the headers of all these files are loaded, reading any that
+        aren't cached in parallel on the pool.
+    */
+    void probe (juce::ThreadPool& pool, const juce::Array<juce::File>& files);
+
+    /** Returns a file's header, reading it first if it isn't already cached. */
+    SampleHeader getHeader (const juce::File& file);
+
+    /** Returns the size of a file in bytes, as seen when its header was last
+        checked, or 0 if it doesn't exist.
+    */
+    juce::int64 getFileSize (const juce::File& file);
+
+    /** Makes every entry be checked against its file again the next time it's
+        used, for processes that outlive a single run.
+    */
+    void startNewRun();
+
+    /** Drops stale entries, then writes the cache file. */
+    bool save();
+
+    /** The cache file used when none is given on the command line. */
+    static juce::File getDefaultCacheFile();
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        juce::int64 size = 0, modificationTime = 0;     // modificationTime is in nanoseconds
+        int lastUsedDay = 0;                            // days since 1970
+        bool checkedThisRun = false;
+        SampleHeader header;
+    };
+
+    void load();
+    void prune();
+    static bool getFileStamp (const juce::File& file, juce::int64& size, juce::int64& modificationTime);
+
+    ProfileStats& stats;
+    DeviceThrottle& metadataThrottle;
+    const juce::File cacheFile;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, Entry> entries;
+    bool hasChanged = false;
+
+    JUCE_DECLARE_NON_COPYABLE (SampleHeaderCache)
+};
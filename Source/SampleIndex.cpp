@@ -0,0 +1,309 @@
+/*
+  ==============================================================================
+
+    SampleIndex.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleIndex.h"
+
+#if ! JUCE_WINDOWS
+ #include <dirent.h>
+ #include <sys/stat.h>
+#endif
+
+//==============================================================================
+SampleIndex::SampleIndex (ProfileStats& s, DeviceThrottle& t, const Options& o)
+    : stats (s), metadataThrottle (t), options (o), excludes (o.excludePatterns)
+{
+}
+
+bool SampleIndex::fileExists (const juce::File& file)
+{
+    if(! options.lowMetadata) {
+        auto device = metadataThrottle.getDeviceForDirectory (file.getParentDirectory(), stats);
+        const DeviceThrottle::ScopedSlot slot (metadataThrottle, device, device);
+
+        countMetadataOperation ("metadata.stats");
+
+        // Symlinks are treated as they are in listings, which leave them out
+        // unless they're being followed.
+       #if JUCE_WINDOWS
+        return file.existsAsFile() && (options.followSymlinks || ! file.isSymbolicLink());
+       #else
+        struct stat info;
+        auto path = file.getFullPathName();
+        return (options.followSymlinks ? stat (path.toRawUTF8(), &info) : lstat (path.toRawUTF8(), &info)) == 0
+                && S_ISREG (info.st_mode);
+       #endif
+    }
+
+    return getListing (file.getParentDirectory())->files.contains (file.getFileName());
+}
+
+juce::File SampleIndex::findFileNamed (const juce::File& rootDirectory, const juce::String& fileName)
+{
+    auto rootKey = rootDirectory.getFullPathName();
+    std::promise<IndexPtr> promise;
+    std::shared_future<IndexPtr> future;
+    bool isBuilding = false;
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto existing = indexesByRoot.find (rootKey);
+        if(existing != indexesByRoot.end()) {
+            future = existing->second;
+        } else {
+            future = promise.get_future().share();
+            indexesByRoot.emplace (rootKey, future);
+            isBuilding = true;
+        }
+    }
+
+    if(isBuilding) {
+        auto index = std::make_shared<FilesByName>();
+        Traversal traversal { rootDirectory, *index, {}, {} };
+        addToIndex (traversal, rootDirectory);
+        promise.set_value (std::move (index));
+    }
+
+    auto index = future.get();
+    auto found = index->find (fileName.toLowerCase());
+    if(found == index->end())
+        return {};
+
+    for(auto& candidate : found->second)
+        if(candidate.getFileName() == fileName)
+            return candidate;
+
+    return found->second.getFirst();
+}
+
+void SampleIndex::invalidate (const juce::File& directory, bool includeSubdirectories)
+{
+    const juce::ScopedLock sl (lock);
+
+    for(auto it = listings.begin(); it != listings.end();) {
+        juce::File listed (it->first);
+
+        if(listed == directory || (includeSubdirectories && listed.isAChildOf (directory))) {
+            for(auto alias = listedPaths.begin(); alias != listedPaths.end();)
+                alias = alias->second == it->first ? listedPaths.erase (alias) : std::next (alias);
+
+            it = listings.erase (it);
+            stats.add ("index.listingsInvalidated");
+        } else {
+            ++it;
+        }
+    }
+
+    // The recursive indexes are rebuilt from the listings that are left, so
+    // only the directories forgotten here are read again.
+    indexesByRoot.clear();
+}
+
+//==============================================================================
+SampleIndex::ListingPtr SampleIndex::getListing (const juce::File& directory, const FileId* knownId)
+{
+    auto key = directory.getFullPathName();
+    std::promise<ListingPtr> promise;
+    std::shared_future<ListingPtr> future;
+    bool isListing = false;
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto existing = listings.find (key);
+        if(existing != listings.end())
+            future = existing->second;
+
+        // The same directory reached through a different path, e.g. via a symlink.
+        if(! future.valid() && knownId != nullptr) {
+            auto alias = listedPaths.find (*knownId);
+            if(alias != listedPaths.end()) {
+                auto aliased = listings.find (alias->second);
+                if(aliased != listings.end())
+                    future = aliased->second;
+            }
+        }
+
+        if(! future.valid()) {
+            future = promise.get_future().share();
+            listings.emplace (key, future);
+            isListing = true;
+        }
+    }
+
+    if(! isListing)
+        return future.get();
+
+    auto listing = std::make_shared<const Listing> (listDirectory (directory));
+    promise.set_value (listing);
+
+    const juce::ScopedLock sl (lock);
+    listedPaths.emplace (listing->id, key);
+    return listing;
+}
+
+bool SampleIndex::hasAlreadyVisited (const Traversal& traversal, const FileId& id)
+{
+    if(std::find (traversal.ancestors.begin(), traversal.ancestors.end(), id) != traversal.ancestors.end()) {
+        stats.add ("index.symlinkCyclesDetected");
+        return true;
+    }
+
+    if(traversal.visited.count (id) > 0) {
+        stats.add ("index.duplicateDirectoriesSkipped");
+        return true;
+    }
+
+    return false;
+}
+
+void SampleIndex::addToIndex (Traversal& traversal, const juce::File& directory, const FileId* knownId)
+{
+    // Held for the walk, as invalidate() can drop the entry meanwhile.
+    auto listingPtr = getListing (directory, knownId);
+    auto& listing = *listingPtr;
+    if(hasAlreadyVisited (traversal, listing.id))
+        return;
+
+    traversal.visited.insert (listing.id);
+    stats.add ("index.directoriesIndexed");
+
+    auto isExcluded = [&] (const juce::String& name)
+    {
+        if(excludes.isEmpty())
+            return false;
+
+        auto relativePath = directory.getChildFile (name).getRelativePathFrom (traversal.root).replaceCharacter ('\\', '/');
+        return excludes.matches (name, relativePath);
+    };
+
+    for(auto& name : listing.files) {
+        if(isExcluded (name)) {
+            stats.add ("index.filesExcluded");
+            continue;
+        }
+
+        traversal.index[name.toLowerCase()].add (directory.getChildFile (name));
+        stats.add ("index.filesIndexed");
+    }
+
+    traversal.ancestors.push_back (listing.id);
+
+    for(auto& subdirectory : listing.subdirectories) {
+        if(isExcluded (subdirectory.name)) {
+            stats.add ("index.directoriesPruned");
+            continue;
+        }
+
+        // Checking the id from the parent's listing first means an alias of a
+        // directory we've already walked is never even opened.
+        if(hasAlreadyVisited (traversal, subdirectory.id))
+            continue;
+
+        addToIndex (traversal, directory.getChildFile (subdirectory.name), &subdirectory.id);
+    }
+
+    traversal.ancestors.pop_back();
+}
+
+SampleIndex::Listing SampleIndex::listDirectory (const juce::File& directory)
+{
+    Listing listing;
+    countMetadataOperation ("metadata.directoryListings");
+
+   #if JUCE_WINDOWS
+    // There are no inode numbers to go on here, so directories are identified
+    // by path. FindNextFile already tells us which entries are directories.
+    auto idForPath = [] (const juce::File& f) { return FileId { 0, (juce::uint64) f.getFullPathName().toLowerCase().hashCode64() }; };
+    listing.id = idForPath (directory);
+
+    auto device = metadataThrottle.getDeviceForDirectory (directory, stats);
+    const DeviceThrottle::ScopedSlot slot (metadataThrottle, device, device);
+
+    for(auto& entry : juce::RangedDirectoryIterator (directory, false, "*", juce::File::findFilesAndDirectories)) {
+        auto file = entry.getFile();
+
+        if(! options.followSymlinks && file.isSymbolicLink()) {
+            stats.add ("index.symlinksIgnored");
+            continue;
+        }
+
+        if(entry.isDirectory())
+            listing.subdirectories.push_back ({ file.getFileName(), idForPath (file) });
+        else
+            listing.files.add (file.getFileName());
+    }
+   #else
+    // JUCE's iterator stats every entry it returns, so use readdir's d_type and
+    // d_ino directly and only fall back to stat for symlinks, or when the
+    // filesystem doesn't fill them in.
+    auto* dir = opendir (directory.getFullPathName().toRawUTF8());
+    if(dir == nullptr)
+        return listing;
+
+    // Answered from the handle opendir already holds, so it isn't counted.
+    struct stat info;
+    if(fstat (dirfd (dir), &info) == 0) {
+        listing.id = { (juce::uint64) info.st_dev, (juce::uint64) info.st_ino };
+        metadataThrottle.rememberDevice (directory, listing.id.device);
+    }
+
+    // Only the reads are throttled, since finding the device needs the
+    // directory open, but on a network share they're most of the work.
+    const DeviceThrottle::ScopedSlot slot (metadataThrottle, listing.id.device, listing.id.device);
+
+    while(auto* entry = readdir (dir)) {
+        auto name = juce::String::fromUTF8 (entry->d_name);
+        if(name == "." || name == "..")
+            continue;
+
+        auto path = directory.getChildFile (name).getFullPathName();
+        auto type = entry->d_type;
+        FileId id { listing.id.device, (juce::uint64) entry->d_ino };
+
+        if(type == DT_UNKNOWN) {
+            countMetadataOperation ("metadata.stats");
+            if(lstat (path.toRawUTF8(), &info) != 0)
+                continue;
+
+            type = S_ISLNK (info.st_mode) ? DT_LNK : (S_ISDIR (info.st_mode) ? DT_DIR : (S_ISREG (info.st_mode) ? DT_REG : DT_UNKNOWN));
+            id = { (juce::uint64) info.st_dev, (juce::uint64) info.st_ino };
+        }
+
+        if(type == DT_LNK) {
+            if(! options.followSymlinks) {
+                stats.add ("index.symlinksIgnored");
+                continue;
+            }
+
+            countMetadataOperation ("metadata.stats");
+            if(stat (path.toRawUTF8(), &info) != 0)
+                continue;   // dangling link
+
+            type = S_ISDIR (info.st_mode) ? DT_DIR : (S_ISREG (info.st_mode) ? DT_REG : DT_UNKNOWN);
+            id = { (juce::uint64) info.st_dev, (juce::uint64) info.st_ino };
+        }
+
+        if(type == DT_DIR)
+            listing.subdirectories.push_back ({ name, id });
+        else if(type == DT_REG)
+            listing.files.add (name);
+    }
+
+    closedir (dir);
+   #endif
+
+    // Sorted so that name lookups pick the same file on every machine.
+    listing.files.sort (false);
+    std::sort (listing.subdirectories.begin(), listing.subdirectories.end(),
+               [] (const Subdirectory& a, const Subdirectory& b) { return a.name < b.name; });
+    return listing;
+}
+
+void SampleIndex::countMetadataOperation (const char* counterName)
+{
+    stats.add (counterName);
+}
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    SampleIndex.h
+
+    A cache of directory listings used to find sample files with as few
+    filesystem metadata operations as possible.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeviceThrottle.h"
+#include "GlobMatcher.h"
+#include "ProfileStats.h"
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+
+//==============================================================================
+/**
+    Answers "does this file exist?" and "where is the file called X?" for the
+    sample hunting stage.
+
+    Each directory is listed at most once for the lifetime of the index, even
+    when it can be reached through several paths, and recursive searches track
+    the (device, inode) of every directory they enter so that symlinked folders
+    are only walked once and symlink loops are detected rather than followed.
+    Excluded folders are pruned before they're opened.
+
+    The index is shared by every conversion in a run, and is thread-safe.
+    Directories are listed and indexes built outside the lock, so searches of
+    different folders run in parallel, while threads that want a listing or
+    index that's already being made wait for it instead of making their own.
+    Its stat calls and directory listings each take a slot from the metadata
+    throttle for the device they're on.
+*/
+class SampleIndex
+{
+public:
+    struct Options
+    {
+        /** Answers existence checks from the parent directory's listing instead
+            of with a stat call. Much cheaper on network filesystems.
+        */
+        bool lowMetadata = false;
+
+        /** If false, symlinked files and directories are left out of the index. */
+        bool followSymlinks = true;
+
+        /** Glob patterns for files and folders that searches should skip.
+            Matching folders are pruned without being listed.
+        */
+        juce::StringArray excludePatterns;
+    };
+
+    SampleIndex (ProfileStats& stats, DeviceThrottle& metadataThrottle, const Options& options);
+
+    /** Returns true if the file exists. Unless symlinks are being followed,
+        a symlink doesn't count, just as it's left out of directory listings.
+    */
+    bool fileExists (const juce::File& file);
+
+    /** Searches rootDirectory and everything below it for a file with this name.
+
+        An exact match is preferred, but a case-insensitive one is accepted, as
+        EXS files are usually written on case-insensitive filesystems. Returns
+        File() if nothing was found.
+    */
+    juce::File findFileNamed (const juce::File& rootDirectory, const juce::String& fileName);
+
+    /** Forgets the listing of a directory that has changed, and optionally of
+        every directory below it, so that they're listed again when next needed.
+    */
+    void invalidate (const juce::File& directory, bool includeSubdirectories);
+
+private:
+    //==============================================================================
+    struct FileId
+    {
+        juce::uint64 device = 0, inode = 0;
+
+        bool operator== (const FileId& other) const noexcept    { return device == other.device && inode == other.inode; }
+        bool operator<  (const FileId& other) const noexcept    { return device != other.device ? device < other.device : inode < other.inode; }
+    };
+
+    struct Subdirectory
+    {
+        juce::String name;
+        FileId id;
+    };
+
+    struct Listing
+    {
+        FileId id;
+        juce::StringArray files;
+        std::vector<Subdirectory> subdirectories;
+    };
+
+    using FilesByName = std::map<juce::String, juce::Array<juce::File>>;
+
+    struct Traversal
+    {
+        juce::File root;
+        FilesByName& index;
+        std::set<FileId> visited;
+        std::vector<FileId> ancestors;
+    };
+
+    using ListingPtr = std::shared_ptr<const Listing>;
+    using IndexPtr = std::shared_ptr<const FilesByName>;
+
+    ListingPtr getListing (const juce::File& directory, const FileId* knownId = nullptr);
+    Listing listDirectory (const juce::File& directory);
+    void addToIndex (Traversal& traversal, const juce::File& directory, const FileId* knownId = nullptr);
+    bool hasAlreadyVisited (const Traversal& traversal, const FileId& id);
+    void countMetadataOperation (const char* counterName);
+
+    ProfileStats& stats;
+    DeviceThrottle& metadataThrottle;
+    const Options options;
+    const GlobMatcher excludes;
+
+    juce::CriticalSection lock;
+    // Futures, so that an entry can be claimed under the lock and filled in
+    // outside it by whichever thread claimed it.
+    std::map<juce::String, std::shared_future<ListingPtr>> listings;
+    std::map<FileId, juce::String> listedPaths;
+    std::map<juce::String, std::shared_future<IndexPtr>> indexesByRoot;
+
+    JUCE_DECLARE_NON_COPYABLE (SampleIndex)
+};
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    SampleTranscoder.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleTranscoder.h"
+#include "AudioFiles.h"
+#include "LoopPoints.h"
+#include "ParallelFor.h"
+
+//==============================================================================
+namespace
+{
+    /** Samples that decode to more than this are streamed rather than read whole. */
+    constexpr juce::int64 maxWholeFileBytes = 32 * 1024 * 1024;
+
+    /** What a streamed conversion reserves: the reader's and writer's buffers. */
+    constexpr juce::int64 streamingBytes = 1024 * 1024;
+
+    struct TargetFormat
+    {
+        const char* name;
+        const char* formatName;
+        int bitsPerSample;
+        bool isFloatingPoint;
+    };
+
+    const TargetFormat targetFormats[] =
+    {
+        { "wav16",  "WAV",  16, false },
+        { "wav24",  "WAV",  24, false },
+        { "wav32",  "WAV",  32, false },
+        { "wav32f", "WAV",  32, true  },
+        { "flac16", "FLAC", 16, false },
+        { "flac24", "FLAC", 24, false }
+    };
+}
+
+bool TranscodeTarget::fromName (const juce::String& name, TranscodeTarget& result)
+{
+    for(auto& format : targetFormats) {
+        if(name.equalsIgnoreCase (format.name)) {
+            result.formatName = format.formatName;
+            result.bitsPerSample = format.bitsPerSample;
+            result.isFloatingPoint = format.isFloatingPoint;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+juce::StringArray TranscodeTarget::getNames()
+{
+    juce::StringArray names;
+    for(auto& format : targetFormats)
+        names.add (format.name);
+
+    return names;
+}
+
+juce::String TranscodeTarget::getName() const
+{
+    for(auto& format : targetFormats)
+        if(formatName == format.formatName && bitsPerSample == format.bitsPerSample && isFloatingPoint == format.isFloatingPoint)
+            return format.name;
+
+    return formatName.toLowerCase() + juce::String (bitsPerSample) + (isFloatingPoint ? "f" : "");
+}
+
+juce::String TranscodeTarget::getFileExtension() const
+{
+    return formatName == "FLAC" ? ".flac" : ".wav";
+}
+
+bool TranscodeTarget::matches (const SampleHeader& header) const
+{
+    // SampleHeader names WAV files "WAV"; anything read through JUCE has the
+    // format's own name, e.g. "FLAC file".
+    return header.format.startsWithIgnoreCase (formatName)
+            && header.bitsPerSample == bitsPerSample
+            && header.isFloatingPoint == isFloatingPoint;
+}
+
+//==============================================================================
+SampleTranscoder::SampleTranscoder (ProfileStats& s, juce::int64 memoryBudgetBytes)
+    : stats (s), memory (memoryBudgetBytes)
+{
+}
+
+juce::Result SampleTranscoder::transcode (PresetDocument& preset, SampleHeaderCache& headers, const TranscodeTarget& format,
+                                          const juce::File& targetDirectory, juce::ThreadPool& pool)
+{
+    auto created = targetDirectory.createDirectory();
+    if(created.failed())
+        return juce::Result::fail ("Couldn't create \"" + targetDirectory.getFullPathName() + "\": " + created.getErrorMessage());
+
+    TargetClaims::Request request;
+
+    for(auto& source : preset.getUniqueSampleFiles()) {
+        auto header = headers.getHeader (source);
+        if(! header.isValid) {
+            stats.add ("transcode.unreadable");
+            continue;
+        }
+
+        if(format.matches (header)) {
+            stats.add ("transcode.alreadyInFormat");
+            continue;
+        }
+
+        auto target = targetDirectory.getChildFile (source.getFileNameWithoutExtension() + format.getFileExtension());
+
+        // e.g. a 24-bit WAV converted to 16 bits with no sample directory. The
+        // original is the user's, so it's never overwritten.
+        if(target == source)
+            target = targetDirectory.getChildFile (source.getFileNameWithoutExtension() + "." + format.getName() + format.getFileExtension());
+
+        request.add (target, source);
+    }
+
+    auto claimed = claims.claim (request, "transcoded to");
+    if(claimed.failed())
+        return claimed;
+
+    juce::StringArray errors;
+    juce::CriticalSection errorLock;
+
+    // Files claimed by an earlier preset in this run are converted by it.
+    parallelFor (pool, request.size(), [&] (int i)
+    {
+        if(! request.isOwner (i))
+            return;
+
+        auto result = transcodeFile (request.getSource (i), request.getTarget (i), format, headers);
+        request.finish (i, result);
+
+        if(result.failed()) {
+            const juce::ScopedLock sl (errorLock);
+            errors.add (result.getErrorMessage());
+        }
+    });
+
+    if(! errors.isEmpty())
+        return juce::Result::fail (errors.joinIntoString ("\n"));
+
+    // Zones are only pointed at files that were actually written.
+    auto waited = request.waitForOthers();
+    if(waited.failed())
+        return waited;
+
+    std::map<juce::String, juce::File> replacements;
+    for(int i = 0; i < request.size(); ++i)
+        replacements[request.getSource (i).getFullPathName()] = request.getTarget (i);
+
+    for(auto* sample : preset.getSamples()) {
+        auto source = preset.getSampleFile (*sample);
+        auto replacement = replacements.find (source.getFullPathName());
+        if(replacement == replacements.end())
+            continue;
+
+        writeEmbeddedLoopAttributes (*sample, headers.getHeader (source));
+        preset.setSampleFile (*sample, replacement->second);
+    }
+
+    return juce::Result::ok();
+}
+
+void SampleTranscoder::startNewRun()
+{
+    claims.clear();
+}
+
+juce::Result SampleTranscoder::transcodeFile (const juce::File& source, const juce::File& target, const TranscodeTarget& format,
+                                              SampleHeaderCache& headers)
+{
+    if(source == target)
+        return juce::Result::fail ("\"" + source.getFullPathName() + "\" would be transcoded onto itself.");
+
+    // An earlier conversion may have been to another bit depth, so its header
+    // is checked as well as its age.
+    if(target.existsAsFile()
+        && target.getLastModificationTime() >= source.getLastModificationTime()
+        && format.matches (headers.getHeader (target))) {
+        stats.add ("transcode.upToDate");
+        return juce::Result::ok();
+    }
+
+    auto reader = createSampleReader (source);
+    if(reader == nullptr)
+        return juce::Result::fail ("Couldn't read \"" + source.getFullPathName() + "\".");
+
+    auto decodedSize = reader->lengthInSamples * (juce::int64) reader->numChannels * (juce::int64) sizeof (float);
+    auto readWholeFile = decodedSize <= maxWholeFileBytes;
+    MemoryBudget::ScopedReservation reservation (memory, readWholeFile ? decodedSize : streamingBytes);
+
+    auto cantWrite = juce::Result::fail ("Couldn't write \"" + target.getFullPathName() + "\".");
+    juce::TemporaryFile temp (target);
+
+    {
+        juce::WavAudioFormat wav;
+        juce::FlacAudioFormat flac;
+        auto& audioFormat = format.formatName == "FLAC" ? static_cast<juce::AudioFormat&> (flac) : wav;
+
+        auto writer = createSampleWriter (temp.getFile(), audioFormat, reader->sampleRate, (int) reader->numChannels,
+                                          format.bitsPerSample, format.isFloatingPoint, reader->metadataValues);
+        if(writer == nullptr)
+            return cantWrite;
+
+        if(readWholeFile) {
+            juce::AudioBuffer<float> buffer ((int) reader->numChannels, (int) reader->lengthInSamples);
+            if(! reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true))
+                return juce::Result::fail ("Couldn't read \"" + source.getFullPathName() + "\".");
+
+            if(! writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples()))
+                return cantWrite;
+        } else {
+            if(! writer->writeFromAudioReader (*reader, 0, reader->lengthInSamples))
+                return cantWrite;
+
+            stats.add ("transcode.streamed");
+        }
+    }
+
+    if(! temp.overwriteTargetFileWithTemporary())
+        return cantWrite;
+
+    stats.add ("transcode.filesConverted");
+    stats.add ("transcode.bytesRead", source.getSize());
+    return juce::Result::ok();
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    SampleTranscoder.h
+
+    Converts the samples a preset uses to a single file format.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryBudget.h"
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+#include "TargetClaims.h"
+#include <map>
+
+//==============================================================================
+/** The format samples are transcoded to. */
+struct TranscodeTarget
+{
+    juce::String formatName;        // "WAV" or "FLAC"
+    int bitsPerSample = 24;
+    bool isFloatingPoint = false;
+
+    /** Parses a name like "wav24", "wav32f" or "flac16". */
+    static bool fromName (const juce::String& name, TranscodeTarget& result);
+
+    /** The names fromName() accepts. */
+    static juce::StringArray getNames();
+
+    /** The name fromName() would take for this format, e.g. "flac24". */
+    juce::String getName() const;
+
+    juce::String getFileExtension() const;
+
+    /** True if a sample with this header is already in this format. */
+    bool matches (const SampleHeader& header) const;
+};
+
+//==============================================================================
+/**
+    Rewrites every sample a preset uses in one format and bit depth, for
+    libraries that mix AIFF, CAF, WAV and different bit depths.
+
+    Converted files are written to a target directory, keeping their names
+    with the new extension, and the zones are pointed at them. A source is
+    never written to: where its converted file would have its own path, the
+    format's name is added to it, e.g. "Piano C3.wav16.wav". Samples already
+    in the target format are left alone, as are conversions that are newer
+    than their source and already in the target format. Sample rates are
+    never changed, so loop points stay valid; loops and root notes are written
+    out as attributes in case the new format can't carry them.
+
+    Files are converted in parallel on the pool. A file that another preset is
+    converting is waited for, and zones are only pointed at it once it has
+    been written. Each conversion reserves the memory it decodes into from a
+    shared budget: small samples are decoded whole, larger ones are streamed
+    through a fixed-size block. All methods are thread-safe.
+*/
+class SampleTranscoder
+{
+public:
+    SampleTranscoder (ProfileStats& stats, juce::int64 memoryBudgetBytes);
+
+    /** Converts the preset's samples into targetDirectory. Fails if any of them
+        couldn't be converted, or if two different files would end up with the
+        same name.
+    */
+    juce::Result transcode (PresetDocument& preset, SampleHeaderCache& headers, const TranscodeTarget& target,
+                            const juce::File& targetDirectory, juce::ThreadPool& pool);
+
+    /** Forgets which files were converted this run, so they're checked again
+        the next time they're converted.
+    */
+    void startNewRun();
+
+private:
+    juce::Result transcodeFile (const juce::File& source, const juce::File& target, const TranscodeTarget& format,
+                                SampleHeaderCache& headers);
+
+    ProfileStats& stats;
+    MemoryBudget memory;
+
+    TargetClaims claims;
+
+    JUCE_DECLARE_NON_COPYABLE (SampleTranscoder)
+};
@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    SilenceTrimmer.cpp
+
+  ==============================================================================
+*/
+
+#include "SilenceTrimmer.h"
+#include "AudioFiles.h"
+#include "LoopPoints.h"
+#include "ParallelFor.h"
+
+//==============================================================================
+namespace
+{
+    constexpr int scanBlockSize = 16384;
+
+    int getOutputBitDepth (const SampleHeader& header)
+    {
+        if(header.isFloatingPoint || header.bitsPerSample > 24)
+            return 32;
+
+        return header.bitsPerSample > 16 ? 24 : 16;
+    }
+}
+
+//==============================================================================
+SilenceTrimmer::SilenceTrimmer (ProfileStats& s, float thresholdDecibels)
+    : stats (s), threshold (juce::Decibels::decibelsToGain (thresholdDecibels))
+{
+}
+
+juce::Range<juce::int64> SilenceTrimmer::getAudibleRange (const juce::File& file)
+{
+    auto key = file.getFullPathName();
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto existing = audibleRanges.find (key);
+        if(existing != audibleRanges.end())
+            return existing->second;
+    }
+
+    auto range = scanForAudibleRange (file);
+
+    const juce::ScopedLock sl (lock);
+    audibleRanges[key] = range;
+    return range;
+}
+
+void SilenceTrimmer::startNewRun()
+{
+    const juce::ScopedLock sl (lock);
+    audibleRanges.clear();
+    claims.clear();
+}
+
+juce::Range<juce::int64> SilenceTrimmer::scanForAudibleRange (const juce::File& file) const
+{
+    auto reader = createSampleReader (file);
+    if(reader == nullptr)
+        return {};
+
+    stats.add ("trim.samplesAnalysed");
+
+    const auto length = reader->lengthInSamples;
+    const auto numChannels = (int) reader->numChannels;
+    juce::AudioBuffer<float> buffer (numChannels, scanBlockSize);
+
+    auto blockIsAudible = [&] (int numSamples)
+    {
+        for(int channel = 0; channel < numChannels; ++channel) {
+            auto range = juce::FloatVectorOperations::findMinAndMax (buffer.getReadPointer (channel), numSamples);
+            if(range.getEnd() > threshold || range.getStart() < -threshold)
+                return true;
+        }
+
+        return false;
+    };
+
+    auto frameIsAudible = [&] (int index)
+    {
+        for(int channel = 0; channel < numChannels; ++channel)
+            if(std::abs (buffer.getSample (channel, index)) > threshold)
+                return true;
+
+        return false;
+    };
+
+    juce::int64 start = -1;
+
+    for(juce::int64 position = 0; position < length && start < 0; position += scanBlockSize) {
+        auto numSamples = (int) juce::jmin ((juce::int64) scanBlockSize, length - position);
+        reader->read (&buffer, 0, numSamples, position, true, true);
+        if(! blockIsAudible (numSamples))
+            continue;
+
+        for(int i = 0; i < numSamples; ++i) {
+            if(frameIsAudible (i)) {
+                start = position + i;
+                break;
+            }
+        }
+    }
+
+    if(start < 0) {
+        stats.add ("trim.silentSamples");
+        return {};
+    }
+
+    auto end = start + 1;
+
+    for(auto position = length; position > start;) {
+        auto blockStart = juce::jmax (start, position - scanBlockSize);
+        auto numSamples = (int) (position - blockStart);
+        reader->read (&buffer, 0, numSamples, blockStart, true, true);
+
+        if(blockIsAudible (numSamples)) {
+            for(int i = numSamples; --i >= 0;) {
+                if(frameIsAudible (i)) {
+                    end = blockStart + i + 1;
+                    break;
+                }
+            }
+
+            break;
+        }
+
+        position = blockStart;
+    }
+
+    return { start, end };
+}
+
+//==============================================================================
+juce::Result SilenceTrimmer::trim (PresetDocument& preset, SampleHeaderCache& headers, juce::ThreadPool& pool,
+                                  const juce::File& trimmedFileDirectory)
+{
+    auto files = preset.getUniqueSampleFiles();
+
+    {
+        ProfileStats::ScopedStage stage (stats, "trim.analysis");
+        parallelFor (pool, files.size(), [&] (int i) { getAudibleRange (files.getReference (i)); });
+    }
+
+    // Each trimmed copy keeps the audible range of its file, plus any loop
+    // stored in the file itself.
+    std::map<juce::String, std::pair<juce::File, juce::Range<juce::int64>>> trimmedFiles;
+
+    if(trimmedFileDirectory != juce::File()) {
+        auto created = trimmedFileDirectory.createDirectory();
+        if(created.failed())
+            return juce::Result::fail ("Couldn't create \"" + trimmedFileDirectory.getFullPathName() + "\": " + created.getErrorMessage());
+
+        TargetClaims::Request request;
+
+        for(auto& source : files) {
+            auto header = headers.getHeader (source);
+            auto range = getAudibleRange (source);
+            if(! header.isValid || range.isEmpty())
+                continue;
+
+            if(header.loopStart >= 0)
+                range = range.getUnionWith ({ header.loopStart, header.loopEnd + 1 });
+
+            auto target = trimmedFileDirectory.getChildFile (source.getFileNameWithoutExtension() + ".wav");
+
+            // Other zones may still need all of the original, so it's never trimmed in place.
+            if((range.getStart() <= 0 && range.getEnd() >= header.lengthInSamples) || target == source)
+                continue;
+
+            request.add (target, source);
+            trimmedFiles[source.getFullPathName()] = { target, range };
+        }
+
+        auto claimed = claims.claim (request, "trimmed to");
+        if(claimed.failed())
+            return claimed;
+
+        juce::StringArray errors;
+        juce::CriticalSection errorLock;
+
+        // Copies claimed by an earlier preset in this run are written by it.
+        parallelFor (pool, request.size(), [&] (int i)
+        {
+            if(! request.isOwner (i))
+                return;
+
+            auto& source = request.getSource (i);
+            auto result = writeTrimmedFile (source, headers.getHeader (source), trimmedFiles.at (source.getFullPathName()).second,
+                                            request.getTarget (i));
+            request.finish (i, result);
+
+            if(result.failed()) {
+                const juce::ScopedLock sl (errorLock);
+                errors.add (result.getErrorMessage());
+            }
+        });
+
+        if(! errors.isEmpty())
+            return juce::Result::fail (errors.joinIntoString ("\n"));
+
+        // Zones are only pointed at copies that were actually written.
+        auto waited = request.waitForOthers();
+        if(waited.failed())
+            return waited;
+    }
+
+    for(auto* sample : preset.getSamples()) {
+        auto file = preset.getSampleFile (*sample);
+        auto header = headers.getHeader (file);
+        auto audible = getAudibleRange (file);
+        if(! header.isValid || audible.isEmpty())
+            continue;
+
+        const auto zoneStart = (juce::int64) sample->getDoubleAttribute ("start", 0);
+        const auto zoneEnd = (juce::int64) sample->getDoubleAttribute ("end", (double) header.lengthInSamples);
+
+        auto start = juce::jmax (zoneStart, audible.getStart());
+        auto end = juce::jmin (zoneEnd, audible.getEnd());
+
+        juce::int64 loopStart, loopEnd;
+        if(getZoneLoop (*sample, header, loopStart, loopEnd)) {
+            start = juce::jmax (zoneStart, juce::jmin (start, loopStart));
+            end = juce::jmin (zoneEnd, juce::jmax (end, loopEnd + 1));
+        }
+
+        if(start >= end || (start == zoneStart && end == zoneEnd))
+            continue;
+
+        stats.add ("trim.zonesTrimmed");
+
+        auto trimmed = trimmedFiles.find (file.getFullPathName());
+        if(trimmed != trimmedFiles.end() && trimmed->second.second.contains (juce::Range<juce::int64> (start, end))) {
+            auto& [trimmedFile, trimmedRange] = trimmed->second;
+            auto offset = trimmedRange.getStart();
+
+            writeEmbeddedLoopAttributes (*sample, header, -offset);
+            preset.setSampleFile (*sample, trimmedFile);
+
+            if(start > offset || sample->hasAttribute ("start"))
+                sample->setAttribute ("start", juce::String (start - offset));
+            if(end < trimmedRange.getEnd() || sample->hasAttribute ("end"))
+                sample->setAttribute ("end", juce::String (end - offset));
+
+            continue;
+        }
+
+        if(trimmedFileDirectory != juce::File())
+            stats.add ("trim.zonesKeptOriginal");
+
+        sample->setAttribute ("start", juce::String (start));
+        sample->setAttribute ("end", juce::String (end));
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result SilenceTrimmer::writeTrimmedFile (const juce::File& source, const SampleHeader& header,
+                                               juce::Range<juce::int64> range, const juce::File& target)
+{
+    if(target.existsAsFile() && target.getLastModificationTime() >= source.getLastModificationTime()) {
+        // A copy trimmed at a different threshold would put every zone in the wrong place.
+        auto existing = SampleHeader::readFromFile (target);
+        if(existing.isValid && existing.lengthInSamples == range.getLength()) {
+            stats.add ("trim.upToDate");
+            return juce::Result::ok();
+        }
+    }
+
+    auto reader = createSampleReader (source);
+    if(reader == nullptr)
+        return juce::Result::fail ("Couldn't read \"" + source.getFullPathName() + "\".");
+
+    auto cantWrite = juce::Result::fail ("Couldn't write \"" + target.getFullPathName() + "\".");
+    juce::TemporaryFile temp (target);
+
+    {
+        juce::WavAudioFormat wav;
+        auto writer = createSampleWriter (temp.getFile(), wav, reader->sampleRate, (int) reader->numChannels,
+                                          getOutputBitDepth (header), header.isFloatingPoint);
+
+        if(writer == nullptr || ! writer->writeFromAudioReader (*reader, range.getStart(), range.getLength()))
+            return cantWrite;
+    }
+
+    if(! temp.overwriteTargetFileWithTemporary())
+        return cantWrite;
+
+    stats.add ("trim.filesWritten");
+    stats.add ("trim.framesRemoved", header.lengthInSamples - range.getLength());
+    return juce::Result::ok();
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    SilenceTrimmer.h
+
+    Finds and removes silence at the start and end of samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetDocument.h"
+#include "ProfileStats.h"
+#include "SampleHeaderCache.h"
+#include "TargetClaims.h"
+#include <map>
+
+//==============================================================================
+/**
+    Trims the silent heads and tails of a preset's samples.
+
+    A sample's audible range runs from its first frame above the threshold, on
+    any channel, to its last one. The scan reads forwards from the start and
+    backwards from the end in blocks, and uses JUCE's vectorised min/max
+    kernels to reject silent blocks, so only the blocks either side of the
+    audible edges are examined sample by sample and the middle of a sample is
+    never decoded.
+
+    Trimming never cuts into a zone's loop or outside the zone's own start and
+    end. It can be applied in two ways:
+     - by giving each zone start and end attributes, leaving the files alone
+     - by writing a trimmed WAV copy of each sample and pointing zones at it.
+       Zones whose loop lies in the silence keep the original file and get
+       attributes instead. A copy another preset is writing is waited for,
+       and the preset fails if it couldn't be written.
+
+    Audible ranges are remembered for the rest of the run. All methods are
+    thread-safe.
+*/
+class SilenceTrimmer
+{
+public:
+    SilenceTrimmer (ProfileStats& stats, float thresholdDecibels);
+
+    /** Trims every zone in the preset, analysing its samples in parallel. If
+        trimmedFileDirectory is File(), only attributes are changed; otherwise
+        trimmed copies are written there.
+    */
+    juce::Result trim (PresetDocument& preset, SampleHeaderCache& headers, juce::ThreadPool& pool,
+                       const juce::File& trimmedFileDirectory);
+
+    /** Returns the range of frames from the first one above the threshold to
+        one past the last, or an empty range if the file is silent or can't be
+        read.
+    */
+    juce::Range<juce::int64> getAudibleRange (const juce::File& file);
+
+    /** Forgets the audible ranges and trimmed copies from earlier in the run. */
+    void startNewRun();
+
+private:
+    juce::Range<juce::int64> scanForAudibleRange (const juce::File& file) const;
+    juce::Result writeTrimmedFile (const juce::File& source, const SampleHeader& header,
+                                   juce::Range<juce::int64> range, const juce::File& target);
+
+    ProfileStats& stats;
+    const float threshold;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, juce::Range<juce::int64>> audibleRanges;
+    TargetClaims claims;
+
+    JUCE_DECLARE_NON_COPYABLE (SilenceTrimmer)
+};
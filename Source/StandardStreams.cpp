@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    StandardStreams.cpp
+
+  ==============================================================================
+*/
+
+#include "StandardStreams.h"
+#include <cstdio>
+
+#if JUCE_WINDOWS
+ #include <fcntl.h>
+ #include <io.h>
+#endif
+
+//==============================================================================
+StandardOutputStream::StandardOutputStream()
+{
+   #if JUCE_WINDOWS
+    // Otherwise every "\n" in the preset would come out as "\r\n".
+    _setmode (_fileno (stdout), _O_BINARY);
+   #endif
+}
+
+void StandardOutputStream::flush()
+{
+    std::fflush (stdout);
+}
+
+bool StandardOutputStream::setPosition (juce::int64 newPosition)
+{
+    return newPosition == position;
+}
+
+juce::int64 StandardOutputStream::getPosition()
+{
+    return position;
+}
+
+bool StandardOutputStream::write (const void* data, size_t numBytes)
+{
+    if(std::fwrite (data, 1, numBytes, stdout) != numBytes)
+        return false;
+
+    position += (juce::int64) numBytes;
+    return true;
+}
+
+//==============================================================================
+bool readStandardInput (juce::MemoryBlock& data)
+{
+   #if JUCE_WINDOWS
+    _setmode (_fileno (stdin), _O_BINARY);
+   #endif
+
+    char buffer[65536];
+
+    for(;;) {
+        auto numRead = std::fread (buffer, 1, sizeof (buffer), stdin);
+        data.append (buffer, numRead);
+
+        if(numRead < sizeof (buffer))
+            return std::ferror (stdin) == 0;
+    }
+}
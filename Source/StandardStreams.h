@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    StandardStreams.h
+
+    Standard input and output as JUCE streams, for use in shell pipelines.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Writes straight to the process's standard output, in binary mode. */
+class StandardOutputStream  : public juce::OutputStream
+{
+public:
+    StandardOutputStream();
+
+    void flush() override;
+    bool setPosition (juce::int64 newPosition) override;
+    juce::int64 getPosition() override;
+    bool write (const void* data, size_t numBytes) override;
+
+private:
+    juce::int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (StandardOutputStream)
+};
+
+//==============================================================================
+/** Reads everything on the process's standard input, in binary mode. Returns
+    false if it couldn't be read.
+*/
+bool readStandardInput (juce::MemoryBlock& data);
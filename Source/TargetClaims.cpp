@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    TargetClaims.cpp
+
+  ==============================================================================
+*/
+
+#include "TargetClaims.h"
+
+//==============================================================================
+TargetClaims::Request::~Request()
+{
+    for(auto& item : items)
+        if(item.promise != nullptr)
+            item.promise->set_value (juce::Result::fail ("\"" + item.target.getFullPathName() + "\" wasn't written."));
+}
+
+void TargetClaims::Request::add (const juce::File& target, const juce::File& source)
+{
+    for(auto& item : items)
+        if(item.target == target && item.source == source)
+            return;
+
+    items.push_back ({ target, source, nullptr, {} });
+}
+
+void TargetClaims::Request::finish (int index, const juce::Result& result)
+{
+    auto& item = items[(size_t) index];
+    jassert (item.promise != nullptr);
+
+    item.promise->set_value (result);
+    item.promise.reset();
+}
+
+juce::Result TargetClaims::Request::waitForOthers() const
+{
+    for(auto& item : items) {
+        jassert (item.promise == nullptr);   // this request's own files have to be finished first
+
+        auto result = item.outcome.get();
+        if(result.failed())
+            return result;
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result TargetClaims::claim (Request& request, const juce::String& action)
+{
+    auto conflict = [&] (const juce::String& first, const juce::File& second, const juce::File& target)
+    {
+        return juce::Result::fail ("\"" + first + "\" and \"" + second.getFullPathName()
+                                    + "\" would both be " + action + " \"" + target.getFullPathName() + "\".");
+    };
+
+    // Checked before anything is claimed, so a request that fails leaves no
+    // claims behind for other presets to wait on.
+    std::map<juce::String, juce::String> sourcesInRequest;
+
+    for(auto& item : request.items) {
+        auto inserted = sourcesInRequest.emplace (item.target.getFullPathName(), item.source.getFullPathName());
+        if(! inserted.second)
+            return conflict (inserted.first->second, item.source, item.target);
+    }
+
+    const juce::ScopedLock sl (lock);
+
+    for(auto& item : request.items) {
+        auto existing = claims.find (item.target.getFullPathName());
+        if(existing != claims.end() && existing->second.source != item.source.getFullPathName())
+            return conflict (existing->second.source, item.source, item.target);
+    }
+
+    for(auto& item : request.items) {
+        auto existing = claims.find (item.target.getFullPathName());
+
+        if(existing != claims.end()) {
+            item.outcome = existing->second.outcome;
+        } else {
+            item.promise = std::make_shared<std::promise<juce::Result>>();
+            item.outcome = item.promise->get_future().share();
+            claims[item.target.getFullPathName()] = { item.source.getFullPathName(), item.outcome };
+        }
+    }
+
+    return juce::Result::ok();
+}
+
+void TargetClaims::clear()
+{
+    const juce::ScopedLock sl (lock);
+    claims.clear();
+}
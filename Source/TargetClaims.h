@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    TargetClaims.h
+
+    Tracks the sample files a run writes, so each is made once and every
+    preset using it learns whether that worked.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/**
+    The files the sample stages write for a run, each made from one source.
+
+    A preset claims all the files it needs at once. Each one is either new, in
+    which case the preset makes it and calls Request::finish(), or was claimed
+    by an earlier preset, in which case Request::waitForOthers() waits for that
+    preset to finish making it and fails if it failed. A preset whose claim
+    fails, because a file is claimed for a different source, claims nothing.
+
+    All methods are thread-safe.
+*/
+class TargetClaims
+{
+public:
+    //==============================================================================
+    /** The files one preset needs. */
+    class Request
+    {
+    public:
+        Request() = default;
+
+        /** Fails any file this request claimed but didn't finish, so that
+            nobody waits for it forever.
+        */
+        ~Request();
+
+        /** Adds a file to make from a source. Adding the same pair again does nothing. */
+        void add (const juce::File& target, const juce::File& source);
+
+        int size() const noexcept                               { return (int) items.size(); }
+        const juce::File& getTarget (int index) const           { return items[(size_t) index].target; }
+        const juce::File& getSource (int index) const           { return items[(size_t) index].source; }
+
+        /** True if this request claimed the file, and so has to make it. */
+        bool isOwner (int index) const                          { return items[(size_t) index].promise != nullptr; }
+
+        /** Records how making a file this request owns went. */
+        void finish (int index, const juce::Result& result);
+
+        /** Waits for the files that other requests are making, and returns the
+            first of them that failed. Call it after finishing this request's own.
+        */
+        juce::Result waitForOthers() const;
+
+    private:
+        friend class TargetClaims;
+
+        struct Item
+        {
+            juce::File target, source;
+            std::shared_ptr<std::promise<juce::Result>> promise;
+            std::shared_future<juce::Result> outcome;
+        };
+
+        std::vector<Item> items;
+
+        JUCE_DECLARE_NON_COPYABLE (Request)
+    };
+
+    //==============================================================================
+    TargetClaims() = default;
+
+    /** Claims every file in the request, or none of them if two sources would
+        share a file. The error then names both, and what was being done, e.g.
+        "collected as".
+    */
+    juce::Result claim (Request& request, const juce::String& action);
+
+    /** Forgets every claim. Only call this when no request is running. */
+    void clear();
+
+private:
+    struct Claim
+    {
+        juce::String source;
+        std::shared_future<juce::Result> outcome;
+    };
+
+    juce::CriticalSection lock;
+    std::map<juce::String, Claim> claims;
+
+    JUCE_DECLARE_NON_COPYABLE (TargetClaims)
+};
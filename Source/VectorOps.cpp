@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    VectorOps.cpp
+
+  ==============================================================================
+*/
+
+#include "VectorOps.h"
+
+//==============================================================================
+double VectorOps::sumOfSquares (const float* x, int numValues) noexcept
+{
+    // The lanes are summed in float within a block and in double across
+    // blocks, so long samples don't lose precision.
+    constexpr int blockSize = 4096;
+    double total = 0;
+
+    for(int blockStart = 0; blockStart < numValues; blockStart += blockSize) {
+        auto blockEnd = juce::jmin (numValues, blockStart + blockSize);
+        float lanes[4] = {};
+        int i = blockStart;
+
+        for(; i + 4 <= blockEnd; i += 4)
+            for(int lane = 0; lane < 4; ++lane)
+                lanes[lane] += x[i + lane] * x[i + lane];
+
+        for(; i < blockEnd; ++i)
+            lanes[0] += x[i] * x[i];
+
+        total += (double) ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+    }
+
+    return total;
+}
+
+float VectorOps::sumOfSquaredDifferences (const float* a, const float* b, int numValues) noexcept
+{
+    float lanes[4] = {};
+    int i = 0;
+
+    for(; i + 4 <= numValues; i += 4) {
+        for(int lane = 0; lane < 4; ++lane) {
+            auto difference = a[i + lane] - b[i + lane];
+            lanes[lane] += difference * difference;
+        }
+    }
+
+    for(; i < numValues; ++i)
+        lanes[0] += (a[i] - b[i]) * (a[i] - b[i]);
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
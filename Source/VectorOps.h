@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    VectorOps.h
+
+    Reductions over blocks of audio that FloatVectorOperations doesn't have.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** These accumulate in four independent lanes, which keeps the result the same
+    on every build while letting the compiler turn each loop into SIMD code.
+*/
+namespace VectorOps
+{
+    /** Returns the sum of x[i] * x[i]. */
+    double sumOfSquares (const float* x, int numValues) noexcept;
+
+    /** Returns the sum of (a[i] - b[i]) squared. */
+    float sumOfSquaredDifferences (const float* a, const float* b, int numValues) noexcept;
+}
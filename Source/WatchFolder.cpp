@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    WatchFolder.cpp
+
+  ==============================================================================
+*/
+
+#include "WatchFolder.h"
+#include "InterruptHandler.h"
+#include <algorithm>
+#include <set>
+
+//==============================================================================
+WatchFolder::WatchFolder (const juce::File& source, const juce::File& output,
+                          const ConversionOptions& o, ConversionContext& c, int pollIntervalMilliseconds)
+    : sourceFolder (source), outputFolder (output), options (o), context (c), watcher (pollIntervalMilliseconds)
+{
+    // Watching starts before the first conversions, so nothing saved while
+    // they run is missed.
+    watcher.watch (sourceFolder, true);
+}
+
+ConversionOptions WatchFolder::getOptionsFor (const juce::File& exsFile) const
+{
+    auto result = options;
+    result.inputFile = exsFile;
+    result.outputFile = outputFolder.getChildFile (exsFile.getRelativePathFrom (sourceFolder)).withFileExtension (".dspreset");
+    return result;
+}
+
+bool WatchFolder::isOutput (const juce::File& file) const
+{
+    // With the output in the source folder, the presets and reports it writes
+    // are told apart by their extensions instead.
+    return outputFolder != sourceFolder && (file == outputFolder || file.isAChildOf (outputFolder));
+}
+
+juce::Array<juce::File> WatchFolder::findExsFiles (const juce::File& directory) const
+{
+    juce::Array<juce::File> files;
+
+    for(auto& entry : juce::RangedDirectoryIterator (directory, true, "*", juce::File::findFiles)) {
+        auto file = entry.getFile();
+        if(file.hasFileExtension ("exs") && ! isOutput (file))
+            files.add (file);
+    }
+
+    files.sort();
+    return files;
+}
+
+//==============================================================================
+void WatchFolder::convertOutOfDatePresets()
+{
+    int numUpToDate = 0;
+
+    for(auto& exsFile : findExsFiles (sourceFolder)) {
+        if(InterruptHandler::wasInterrupted())
+            break;
+
+        auto exsOptions = getOptionsFor (exsFile);
+
+        auto presetTime = exsOptions.outputFile.getLastModificationTime();
+
+        if(exsOptions.outputFile.existsAsFile() && presetTime >= exsFile.getLastModificationTime()) {
+            // Samples may have been edited while nothing was watching them.
+            juce::Array<juce::File> samples;
+            auto isNewer = [&] (const juce::File& sample) { return sample.getLastModificationTime() > presetTime; };
+
+            if(findPresetSamples (exsOptions, context, samples).wasOk() && std::none_of (samples.begin(), samples.end(), isNewer)) {
+                rememberSamples (exsFile, samples);
+                ++numUpToDate;
+                continue;
+            }
+        }
+
+        convert (exsFile);
+    }
+
+    context.headerCache.save();
+
+    std::cout << "Watching \"" << sourceFolder.getFullPathName() << "\": " << (int) presets.size() << " presets, "
+              << numUpToDate << " already up to date." << std::endl;
+}
+
+void WatchFolder::run (int debounceMilliseconds)
+{
+    // Changes are waited for a second at a time, so an interrupt is noticed
+    // soon after it arrives even when nothing is changing.
+    while(! InterruptHandler::wasInterrupted()) {
+        auto changes = watcher.waitForChanges (1000, debounceMilliseconds);
+        if(! changes.isEmpty())
+            handleChanges (changes);
+    }
+
+    context.headerCache.save();
+}
+
+//==============================================================================
+void WatchFolder::convert (const juce::File& exsFile)
+{
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+    const auto name = exsFile.getRelativePathFrom (sourceFolder);
+
+    juce::Array<juce::File> samples;
+    auto result = convertPreset (getOptionsFor (exsFile), context, &samples);
+    rememberSamples (exsFile, samples);
+
+    if(result.failed()) {
+        std::cerr << name << ": " << result.getErrorMessage() << std::endl;
+        return;
+    }
+
+    std::cout << "Converted " << name << " (" << juce::roundToInt (juce::Time::getMillisecondCounterHiRes() - startTime) << " ms)" << std::endl;
+}
+
+void WatchFolder::rememberSamples (const juce::File& exsFile, const juce::Array<juce::File>& samples)
+{
+    auto& preset = presets[exsFile.getFullPathName()];
+    preset.samples.clearQuick();
+    preset.missingSampleNames.clearQuick();
+
+    for(auto& sample : samples) {
+        if(! context.sampleIndex.fileExists (sample)) {
+            preset.missingSampleNames.addIfNotAlreadyThere (sample.getFileName().toLowerCase());
+            continue;
+        }
+
+        preset.samples.add (sample);
+
+        if(! sample.isAChildOf (sourceFolder))
+            watcher.watch (sample.getParentDirectory(), false);
+    }
+
+    // Missing samples are hunted for in the sample directory too, which may
+    // not be in the source folder.
+    if(! preset.missingSampleNames.isEmpty() && options.sampleDirectory.isNotEmpty()) {
+        auto sampleDirectory = exsFile.getParentDirectory().getChildFile (options.sampleDirectory);
+        if(sampleDirectory.isDirectory() && ! sampleDirectory.isAChildOf (sourceFolder))
+            watcher.watch (sampleDirectory, true);
+    }
+}
+
+void WatchFolder::handleChanges (const juce::StringArray& paths)
+{
+    std::set<juce::String> affected;
+
+    for(auto& path : paths) {
+        juce::File changed (path);
+        if(isOutput (changed))
+            continue;
+
+        const bool isDirectory = changed.isDirectory();
+        const bool exists = isDirectory || changed.existsAsFile();
+
+        // Only the listings that changed are read again. A directory that
+        // appeared or went away takes everything below it with it.
+        context.sampleIndex.invalidate (changed.getParentDirectory(), false);
+        if(isDirectory || ! exists)
+            context.sampleIndex.invalidate (changed, true);
+
+        if(! isDirectory && changed.hasFileExtension ("exs")) {
+            if(exists && changed.isAChildOf (sourceFolder))
+                affected.insert (path);
+            else
+                presets.erase (path);   // its preset is left where it is
+
+            continue;
+        }
+
+        if(isDirectory && (changed == sourceFolder || changed.isAChildOf (sourceFolder)))
+            for(auto& exsFile : findExsFiles (changed))
+                affected.insert (exsFile.getFullPathName());
+
+        const auto name = changed.getFileName().toLowerCase();
+
+        for(auto& entry : presets) {
+            auto& preset = entry.second;
+            bool isAffected = preset.missingSampleNames.contains (name)
+                               || (isDirectory && ! preset.missingSampleNames.isEmpty());
+
+            for(int i = 0; i < preset.samples.size() && ! isAffected; ++i)
+                isAffected = preset.samples.getReference (i) == changed || preset.samples.getReference (i).isAChildOf (changed);
+
+            if(isAffected)
+                affected.insert (entry.first);
+        }
+    }
+
+    if(affected.empty())
+        return;
+
+    context.startNewRun();
+
+    for(auto& exsPath : affected) {
+        if(InterruptHandler::wasInterrupted())
+            break;
+
+        convert (juce::File (exsPath));
+    }
+
+    context.headerCache.save();
+}
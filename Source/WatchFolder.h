@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    WatchFolder.h
+
+    Keeps a folder of EXS files converted as they and their samples change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConversionJob.h"
+#include "FolderWatcher.h"
+#include <map>
+
+//==============================================================================
+/**
+    The watch command: every EXS file below a source folder is converted to a
+    preset at the same relative path below an output folder, and converted
+    again whenever it, or anything it depends on, changes.
+
+    The source folder is watched recursively, along with the folders of any
+    samples that live outside it. For each batch of changes, only the affected
+    presets are converted:
+     - an EXS file that is created or saved
+     - every preset using a sample that was saved, replaced or deleted
+     - every preset missing a sample with the name of a file that appeared.
+
+    The ConversionContext outlives every batch, so the sample index, sample
+    headers and parsed EXS files stay in memory. Before each batch only the
+    directory listings that changed are dropped, and the headers of samples
+    are checked against their files again.
+
+    Once InterruptHandler has caught a signal, no more presets are started, and
+    the header cache is saved before run() returns. A preset that was never
+    converted is older than its EXS file, so the next start picks it up.
+*/
+class WatchFolder
+{
+public:
+    /** The options give everything except the input and output files. The
+        output folder can be the source folder, but can't contain it. The poll
+        interval is passed on to the FolderWatcher.
+    */
+    WatchFolder (const juce::File& sourceFolder, const juce::File& outputFolder,
+                 const ConversionOptions& options, ConversionContext& context,
+                 int pollIntervalMilliseconds = FolderWatcher::defaultPollIntervalMilliseconds);
+
+    /** Converts every EXS file whose preset is missing or older than it or
+        one of its samples, and finds the samples of the rest.
+    */
+    void convertOutOfDatePresets();
+
+    /** Waits for changes and converts the affected presets, until interrupted. */
+    void run (int debounceMilliseconds);
+
+private:
+    //==============================================================================
+    struct Preset
+    {
+        juce::Array<juce::File> samples;
+
+        /** The lower-case names of samples that couldn't be found. */
+        juce::StringArray missingSampleNames;
+    };
+
+    ConversionOptions getOptionsFor (const juce::File& exsFile) const;
+    juce::Array<juce::File> findExsFiles (const juce::File& directory) const;
+    bool isOutput (const juce::File& file) const;
+
+    void convert (const juce::File& exsFile);
+    void rememberSamples (const juce::File& exsFile, const juce::Array<juce::File>& samples);
+    void handleChanges (const juce::StringArray& paths);
+
+    const juce::File sourceFolder, outputFolder;
+    const ConversionOptions options;
+    ConversionContext& context;
+
+    FolderWatcher watcher;
+    std::map<juce::String, Preset> presets;
+
+    JUCE_DECLARE_NON_COPYABLE (WatchFolder)
+};